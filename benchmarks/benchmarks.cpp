@@ -0,0 +1,307 @@
+// micro-benchmarks of the interpreter, run on a generated script. build the release configuration, then run
+//	benchmarks [name]...
+// to run the benchmarks named (or all of them, if none are). each reports the fastest of several repetitions.
+
+#include "../pysub/lexer.cpp"
+#include "../pysub/execution.cpp"
+#include "../pysub/globals.cpp"
+#include "../pysub/parser.cpp"
+#include "../pysub/scanner.cpp"
+#include "../pysub/source.cpp"
+#include "../pysub/interner.cpp"
+#include "../pysub/arena.cpp"
+#include "../pysub/flat_tree.cpp"
+#include "../pysub/bytecode.cpp"
+#include "../pysub/closures.cpp"
+#include "../pysub/optimizer.cpp"
+#include "../pysub/value.cpp"
+#include "../pysub/bigint.cpp"
+#include "../pysub/arithmetic.cpp"
+#include "../pysub/symbol_table.cpp"
+
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <limits>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace {
+	constexpr size_t line_count = 200000;
+	constexpr size_t variable_count = 50;
+	constexpr int repetitions = 5;
+
+	// the fastest of several runs of function, in milliseconds (the others are slowed by caches warming up, or other processes)
+	double TimeFastest(const std::function<void()>& function) {
+		double fastest = std::numeric_limits<double>::max();
+		for (int i = 0; i < repetitions; ++i) {
+			const auto start = std::chrono::steady_clock::now();
+			function();
+			const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			fastest = std::min(fastest, elapsed.count());
+		}
+		return fastest;
+	}
+
+	void Report(std::string_view name, double milliseconds, size_t count, std::string_view unit) {
+		std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+			<< std::setw(10) << std::setprecision(1) << milliseconds << " ms"
+			<< std::setw(10) << std::setprecision(2) << static_cast<double>(count) / milliseconds / 1000 << " M " << unit << "/s\n";
+	}
+
+	// operator-heavy assignments, e.g. "a7 = ((a3 + 1) * 541 < a12 and not 211 - a9 or 7) % 1000".
+	// every variable is assigned before it is read, and values stay small, so all the arithmetic is on small ints.
+	std::string GenerateScript() {
+		static constexpr std::string_view operators[] = { " + ", " - ", " * ", " / ", " % ", " < ", " == ", " and ", " or " };
+		std::mt19937 random(1);	// the same script every time
+		auto Variable = [&random]() {
+			return "a" + std::to_string(random() % variable_count);
+		};
+		std::string script{};
+		for (size_t i = 0; i < variable_count; ++i) {
+			script += "a" + std::to_string(i) + " = " + std::to_string(i + 1) + '\n';
+		}
+		for (size_t i = variable_count; i < line_count; ++i) {
+			script += Variable() + " = ((" + Variable() + " + 1)";
+			for (int term = 0; term < 5; ++term) {
+				const std::string_view op = operators[random() % std::size(operators)];
+				script += op;
+				if (op == " and " && random() % 2 == 0) {
+					script += "not ";
+				}
+				// literals are never 0, and are the only divisors, so no line raises an error
+				const bool is_divisor = op == " / " || op == " % ";
+				script += !is_divisor && random() % 3 == 0 ? Variable() : std::to_string(random() % 999 + 1);
+			}
+			script += ") % 1000\n";
+		}
+		return script;
+	}
+
+	// lexing the whole script, with one thread up to one per core (chunks of under a MiB are lexed serially regardless)
+	void BenchmarkLex(const std::string& script) {
+		const unsigned max_thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+		for (unsigned thread_count = 1; thread_count <= max_thread_count; ++thread_count) {
+			const double milliseconds = TimeFastest([&script, thread_count]() {
+				Interner interner{};
+				const TokenBuffer tokens = TokenBuffer::Lex(script, &interner, thread_count);
+			});
+			Report("lex (" + std::to_string(thread_count) + (thread_count == 1 ? " thread)" : " threads)"), milliseconds, line_count, "lines");
+		}
+	}
+
+	// building the tree from tokens already lexed
+	void BenchmarkParse(const std::string& script) {
+		Interner interner{};
+		const TokenBuffer tokens = TokenBuffer::Lex(script, &interner);
+		const double milliseconds = TimeFastest([&tokens]() {
+			Parser parser(tokens);
+			const std::unique_ptr<AST> tree = parser.BuildTree();
+		});
+		Report("parse", milliseconds, line_count, "lines");
+	}
+
+	// reading and running a file: cold, lexing, parsing, and compiling it (and writing its cache), then warm, loading the cache
+	void BenchmarkRead(const std::string& script) {
+		const std::filesystem::path file_path = std::filesystem::temp_directory_path() / "pysub_benchmark_read.py";
+		const std::filesystem::path cache_path = file_path.parent_path() / "__pysubcache__" / "pysub_benchmark_read.py.pysubc";
+		std::ofstream(file_path, std::ios::out | std::ios::trunc) << script;
+		const double cold_milliseconds = TimeFastest([&file_path, &cache_path]() {
+			std::filesystem::remove(cache_path);
+			FileExecution file(file_path.string());
+			file.Run();
+		});
+		Report("read (cold)", cold_milliseconds, line_count, "lines");
+		const double warm_milliseconds = TimeFastest([&file_path]() {
+			FileExecution file(file_path.string());
+			if (!file.IsCached()) {
+				throw std::runtime_error("the cache was not loaded");
+			}
+			file.Run();
+		});
+		Report("read (warm)", warm_milliseconds, line_count, "lines");
+		std::cout << "cache of " << std::filesystem::file_size(cache_path) / 1024 << " KiB\n";
+		std::filesystem::remove(file_path);
+		std::filesystem::remove(cache_path);
+	}
+
+	// a plain recursive walk of the tree, as Execution ran code before it was compiled (last at 874663b, which ran ints rather than
+	// Values): the baseline that the bytecode and closure backends are measured against
+	class TreeWalker : public Visitor<TreeWalker, Value> {
+	public:
+		explicit TreeWalker(SymbolTable& _symbol_table) : symbol_table(_symbol_table) {}
+
+		Value VisitBinaryExpression(const BinaryExpression& binary_expression) {
+			const TokenKind op = binary_expression.op.kind;
+			if (Utilities::IsComparison(op)) {
+				Value right_value{};
+				return Value{ Compare(binary_expression, right_value) };
+			}
+			const Value left = Visit(*binary_expression.left);
+			switch (op) {
+			case TokenKind::And:
+				return !Arithmetic::IsZero(left) ? Visit(*binary_expression.right) : left;
+			case TokenKind::Or:
+				return !Arithmetic::IsZero(left) ? left : Visit(*binary_expression.right);
+			case TokenKind::Plus:
+				return Arithmetic::Add(left, Visit(*binary_expression.right));
+			case TokenKind::Minus:
+				return Arithmetic::Subtract(left, Visit(*binary_expression.right));
+			case TokenKind::Star:
+				return Arithmetic::Multiply(left, Visit(*binary_expression.right));
+			case TokenKind::Slash:
+				return Arithmetic::Divide(left, Visit(*binary_expression.right));
+			case TokenKind::Percent:
+				return Arithmetic::Modulo(left, Visit(*binary_expression.right));
+			default:
+				throw std::invalid_argument("invalid binary operator");
+			}
+		}
+		Value VisitUnaryExpression(const UnaryExpression& unary_expression) {
+			Value value = Visit(*unary_expression.expression);
+			switch (unary_expression.op.kind) {
+			case TokenKind::Plus:
+				return value;
+			case TokenKind::Minus:
+				return Arithmetic::Negate(value);
+			case TokenKind::Not:
+				return Value{ Arithmetic::IsZero(value) };
+			default:
+				throw std::invalid_argument("invalid unary operator");
+			}
+		}
+		Value VisitGrouping(const Grouping& grouping) {
+			return Visit(*grouping.expression);
+		}
+		Value VisitAtom(const Atom& atom) {
+			if (atom.value.category == Category::NumericLiteral) {
+				return Utilities::GetLiteralValue(atom.value);
+			}
+			const Value* value = symbol_table.Find(atom.value.symbol);
+			if (!value) {
+				throw std::runtime_error("name '" + std::string{ std::get<std::string_view>(atom.value.value) } + "' is not defined");
+			}
+			return *value;
+		}
+		Value VisitAssignment(const Assignment& assignment) {
+			Value value = Visit(*assignment.value);
+			symbol_table.Assign(assignment.name.symbol, value);
+			return value;
+		}
+	private:
+		SymbolTable& symbol_table;
+
+		// comparisons chain: "a < b < c" means "a < b and b < c", with b evaluated once
+		bool Compare(const BinaryExpression& comparison, Value& right_value) {
+			Value left_value{};
+			const Expression* left = comparison.left;
+			if (left->kind == NodeKind::BinaryExpression && Utilities::IsComparison(static_cast<const BinaryExpression*>(left)->op.kind)) {
+				if (!Compare(*static_cast<const BinaryExpression*>(left), left_value)) {
+					return false;
+				}
+			}
+			else {
+				left_value = Visit(*left);
+			}
+			right_value = Visit(*comparison.right);
+			const int order = Arithmetic::Compare(left_value, right_value);
+			switch (comparison.op.kind) {
+			case TokenKind::Equal:
+				return order == 0;
+			case TokenKind::NotEqual:
+				return order != 0;
+			case TokenKind::Less:
+				return order < 0;
+			case TokenKind::LessEqual:
+				return order <= 0;
+			case TokenKind::Greater:
+				return order > 0;
+			case TokenKind::GreaterEqual:
+				return order >= 0;
+			default:
+				throw std::invalid_argument("invalid comparison operator");
+			}
+		}
+	};
+
+	// running the whole script as one tree, parsed and optimized once, with each backend and with the tree walker.
+	// (unlike evaluate, there is no per-block overhead, so this compares the backends alone.)
+	void BenchmarkBackends(const std::string& script) {
+		Interner interner{};
+		const TokenBuffer tokens = TokenBuffer::Lex(script, &interner);
+		Parser parser(tokens);
+		const std::unique_ptr<AST> tree = parser.BuildTree();
+		Optimizer(*tree).Optimize();
+		for (const Backend backend : { Backend::Bytecode, Backend::Closures }) {
+			const CompiledCode code = Execution::Compile(*tree, interner, backend);
+			const double milliseconds = TimeFastest([&code, &interner, backend]() {
+				Execution execution(CopyOnWrite<Interner>(interner), backend);
+				execution.RunCompiled(code);
+			});
+			Report(backend == Backend::Bytecode ? "one tree (bytecode)" : "one tree (closures)", milliseconds, line_count, "statements");
+		}
+		const double milliseconds = TimeFastest([&tree, &interner]() {
+			SymbolTable symbol_table{};
+			symbol_table.Grow(interner.Size());
+			TreeWalker walker(symbol_table);
+			for (const Statement* statement : tree->statements) {
+				walker.Visit(*statement);
+			}
+		});
+		Report("one tree (tree walker)", milliseconds, line_count, "statements");
+	}
+
+	// running a file already read and compiled, as a read script is run again and again
+	void BenchmarkEvaluate(const std::string& script, Backend backend, std::string_view name) {
+		// compiled from the script, rather than loaded from a cache left by an earlier run
+		const std::filesystem::path file_path = std::filesystem::temp_directory_path() / "pysub_benchmark.py";
+		const std::filesystem::path cache_path = file_path.parent_path() / "__pysubcache__" / "pysub_benchmark.py.pysubc";
+		std::filesystem::remove(cache_path);
+		std::ofstream(file_path, std::ios::out | std::ios::trunc) << script;
+		FileExecution file(file_path.string(), backend);
+		file.Run();	// compiles every block
+		const double milliseconds = TimeFastest([&file]() {
+			file.Run();
+		});
+		Report(name, milliseconds, line_count, "statements");
+		std::filesystem::remove(file_path);
+		std::filesystem::remove(cache_path);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const std::vector<std::string_view> names(argv + 1, argv + argc);
+	auto IsSelected = [&names](std::string_view name) {
+		return names.empty() || std::ranges::find(names, name) != std::end(names);
+	};
+
+	const std::string script = GenerateScript();
+	std::cout << "script of " << line_count << " lines (" << script.size() / 1024 << " KiB)\n";
+	try {
+		if (IsSelected("lex")) {
+			BenchmarkLex(script);
+		}
+		if (IsSelected("parse")) {
+			BenchmarkParse(script);
+		}
+		if (IsSelected("read")) {
+			BenchmarkRead(script);
+		}
+		if (IsSelected("evaluate")) {
+			BenchmarkEvaluate(script, Backend::Bytecode, "evaluate (bytecode)");
+			BenchmarkEvaluate(script, Backend::Closures, "evaluate (closures)");
+		}
+		if (IsSelected("backends")) {
+			BenchmarkBackends(script);
+		}
+	}
+	catch (const std::exception& ex) {
+		std::cout << ex.what() << std::endl;
+		return 1;
+	}
+	return 0;
+}
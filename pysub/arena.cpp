@@ -0,0 +1,57 @@
+#include "arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+Arena::Arena(Arena&& other) noexcept :
+	first_block_size(other.first_block_size),
+	blocks(std::move(other.blocks)),
+	curr(std::exchange(other.curr, nullptr)),
+	block_end(std::exchange(other.block_end, nullptr)),
+	next_block_size(std::exchange(other.next_block_size, other.first_block_size)),
+	bytes_reserved(std::exchange(other.bytes_reserved, 0)) {
+	other.blocks.clear();
+}
+
+Arena& Arena::operator=(Arena&& other) noexcept {
+	if (this != &other) {
+		first_block_size = other.first_block_size;
+		blocks = std::move(other.blocks);
+		other.blocks.clear();
+		curr = std::exchange(other.curr, nullptr);
+		block_end = std::exchange(other.block_end, nullptr);
+		next_block_size = std::exchange(other.next_block_size, other.first_block_size);
+		bytes_reserved = std::exchange(other.bytes_reserved, 0);
+	}
+	return *this;
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+	// alignment is a power of two (as alignof always is)
+	auto Align = [alignment](std::byte* ptr) {
+		const uintptr_t address = reinterpret_cast<uintptr_t>(ptr);
+		return ptr + ((alignment - address % alignment) % alignment);
+	};
+	std::byte* start = curr ? Align(curr) : nullptr;
+	if (!start || start > block_end || static_cast<size_t>(block_end - start) < size) {
+		AddBlock(size + alignment);
+		start = Align(curr);
+	}
+	curr = start + size;
+	return start;
+}
+
+size_t Arena::GetBytesReserved() const {
+	return bytes_reserved;
+}
+
+void Arena::AddBlock(size_t min_size) {
+	// blocks double in size (up to a limit), so small trees stay small and large ones need few blocks.
+	// an object larger than the limit gets a block of its own.
+	const size_t block_size = std::max(next_block_size, min_size);
+	next_block_size = std::min(next_block_size * 2, max_block_size);
+	blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(block_size));
+	curr = blocks.back().get();
+	block_end = curr + block_size;
+	bytes_reserved += block_size;
+}
@@ -0,0 +1,43 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <new>
+
+// bump allocator: objects are placed one after another in large blocks, and every block is freed at once with the arena.
+// destructors are never run, so objects must not own anything outside the arena (pointers into the same arena are fine).
+// moving an arena does not move the objects in it.
+class Arena {
+public:
+	Arena() = default;
+	// for arenas that are usually small, and numerous (so an untouched 4 KiB each adds up)
+	explicit Arena(size_t _first_block_size) : first_block_size(_first_block_size), next_block_size(_first_block_size) {}
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	Arena(Arena&& other) noexcept;
+	Arena& operator=(Arena&& other) noexcept;
+
+	template <typename T, typename... Args>
+	T* Make(Args&&... args) {
+		void* memory = Allocate(sizeof(T), alignof(T));
+		return ::new (memory) T(std::forward<Args>(args)...);
+	}
+	void* Allocate(size_t size, size_t alignment);
+	size_t GetBytesReserved() const;
+private:
+	static constexpr size_t max_block_size = size_t{ 1 } << 20;
+
+	size_t first_block_size = 4096;
+	std::vector<std::unique_ptr<std::byte[]>> blocks{};
+	std::byte* curr = nullptr;
+	std::byte* block_end = nullptr;
+	size_t next_block_size = first_block_size;
+	size_t bytes_reserved = 0;
+
+	void AddBlock(size_t min_size);
+};
+
+#endif
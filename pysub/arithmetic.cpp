@@ -0,0 +1,60 @@
+#include "arithmetic.hpp"
+#include "bigint.hpp"
+
+namespace {
+	// applies operation to the ints as big ints. big ints are used where they are; only small ints are widened (copying a big int would allocate).
+	template <typename Operation>
+	auto ApplyToBigInts(const Value& left, const Value& right, Operation operation) {
+		if (left.IsBigInt() && right.IsBigInt()) {
+			return operation(left.GetBigInt(), right.GetBigInt());
+		}
+		if (left.IsBigInt()) {
+			return operation(left.GetBigInt(), BigInt(right.GetSmallInt()));
+		}
+		if (right.IsBigInt()) {
+			return operation(BigInt(left.GetSmallInt()), right.GetBigInt());
+		}
+		return operation(BigInt(left.GetSmallInt()), BigInt(right.GetSmallInt()));	// small ints whose result is not (e.g. an overflowing product)
+	}
+}
+
+Value Arithmetic::AddBigInts(const Value& left, const Value& right) {
+	return ApplyToBigInts(left, right, [](const BigInt& left_int, const BigInt& right_int) {
+		return Value(left_int + right_int);
+	});
+}
+
+Value Arithmetic::SubtractBigInts(const Value& left, const Value& right) {
+	return ApplyToBigInts(left, right, [](const BigInt& left_int, const BigInt& right_int) {
+		return Value(left_int - right_int);
+	});
+}
+
+Value Arithmetic::MultiplyBigInts(const Value& left, const Value& right) {
+	return ApplyToBigInts(left, right, [](const BigInt& left_int, const BigInt& right_int) {
+		return Value(left_int * right_int);
+	});
+}
+
+Value Arithmetic::DivideBigInts(const Value& left, const Value& right) {
+	return ApplyToBigInts(left, right, [](const BigInt& left_int, const BigInt& right_int) {
+		return Value(BigInt::DivideModulo(left_int, right_int).first);
+	});
+}
+
+Value Arithmetic::ModuloBigInts(const Value& left, const Value& right) {
+	return ApplyToBigInts(left, right, [](const BigInt& left_int, const BigInt& right_int) {
+		return Value(BigInt::DivideModulo(left_int, right_int).second);
+	});
+}
+
+Value Arithmetic::NegateBigInt(const Value& value) {
+	return Value(-value.GetBigInt());
+}
+
+int Arithmetic::CompareBigInts(const Value& left, const Value& right) {
+	return ApplyToBigInts(left, right, [](const BigInt& left_int, const BigInt& right_int) {
+		const std::strong_ordering ordering = left_int <=> right_int;
+		return ordering < 0 ? -1 : ordering > 0 ? 1 : 0;
+	});
+}
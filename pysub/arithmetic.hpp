@@ -0,0 +1,197 @@
+#ifndef ARITHMETIC_HPP
+#define ARITHMETIC_HPP
+
+#include "value.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(_MSC_VER) && defined(_M_X64) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// integer operations shared by everything that runs code, so they agree on python's semantics.
+// every value is an int, and ints do not overflow: results too large for a small int (see Value) become big ints.
+// small operands are handled inline (and cannot overflow 64 bits, being at most 63); anything else goes to the big int functions.
+namespace Arithmetic {
+	// for operands that are not both small ints
+	Value AddBigInts(const Value& left, const Value& right);
+	Value SubtractBigInts(const Value& left, const Value& right);
+	Value MultiplyBigInts(const Value& left, const Value& right);
+	Value DivideBigInts(const Value& left, const Value& right);
+	Value ModuloBigInts(const Value& left, const Value& right);
+	Value NegateBigInt(const Value& value);
+	int CompareBigInts(const Value& left, const Value& right);
+
+	inline bool IsZero(const Value& value) {
+		return value.IsSmallInt() && value.GetSmallInt() == 0;	// a big int is never 0
+	}
+
+	// whether a product overflows 64 bits (product is set if it does not)
+	inline bool MultiplyOverflows(int64_t left, int64_t right, int64_t& product) {
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_mul_overflow(left, right, &product);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		int64_t high = 0;
+		product = _mul128(left, right, &high);
+		return high != (product >> 63);
+#else
+		// operands are small ints, so neither is the smallest int64_t, and negating them is safe
+		const uint64_t left_magnitude = left < 0 ? -left : left;
+		const uint64_t right_magnitude = right < 0 ? -right : right;
+		if (right_magnitude != 0 && left_magnitude > static_cast<uint64_t>(INT64_MAX) / right_magnitude) {
+			return true;
+		}
+		product = left * right;
+		return false;
+#endif
+	}
+
+	// there are no floats, so division is floor division (python's '//'). right is not 0.
+	inline int64_t FloorDivide(int64_t left, int64_t right) {
+		int64_t quotient = left / right;
+		if (left % right != 0 && (left < 0) != (right < 0)) {
+			--quotient;
+		}
+		return quotient;
+	}
+
+	// the result takes the sign of the divisor, as in python. right is not 0.
+	inline int64_t FloorModulo(int64_t left, int64_t right) {
+		int64_t remainder = left % right;
+		if (remainder != 0 && (remainder < 0) != (right < 0)) {
+			remainder += right;
+		}
+		return remainder;
+	}
+
+	inline Value Add(const Value& left, const Value& right) {
+		if (Value::AreSmallInts(left, right)) {
+			return left.GetSmallInt() + right.GetSmallInt();
+		}
+		return AddBigInts(left, right);
+	}
+
+	inline Value Subtract(const Value& left, const Value& right) {
+		if (Value::AreSmallInts(left, right)) {
+			return left.GetSmallInt() - right.GetSmallInt();
+		}
+		return SubtractBigInts(left, right);
+	}
+
+	inline Value Multiply(const Value& left, const Value& right) {
+		if (Value::AreSmallInts(left, right)) {
+			int64_t product = 0;
+			if (!MultiplyOverflows(left.GetSmallInt(), right.GetSmallInt(), product)) {
+				return product;
+			}
+		}
+		return MultiplyBigInts(left, right);
+	}
+
+	inline Value Divide(const Value& left, const Value& right) {
+		if (IsZero(right)) {
+			throw std::runtime_error("integer division or modulo by zero");
+		}
+		if (Value::AreSmallInts(left, right)) {
+			return FloorDivide(left.GetSmallInt(), right.GetSmallInt());
+		}
+		return DivideBigInts(left, right);
+	}
+
+	inline Value Modulo(const Value& left, const Value& right) {
+		if (IsZero(right)) {
+			throw std::runtime_error("integer modulo by zero");
+		}
+		if (Value::AreSmallInts(left, right)) {
+			return FloorModulo(left.GetSmallInt(), right.GetSmallInt());
+		}
+		return ModuloBigInts(left, right);
+	}
+
+	inline Value Negate(const Value& value) {
+		if (value.IsSmallInt()) {
+			return -value.GetSmallInt();
+		}
+		return NegateBigInt(value);
+	}
+
+	// the same, replacing left by the result, as the virtual machine does with the top of its stack.
+	// a small int left is overwritten by the result of small int operands, with none of the reference counting of assigning a value.
+	inline void AddInPlace(Value& left, const Value& right) {
+		if (Value::AreSmallInts(left, right)) {
+			left.AssignOverSmallInt(left.GetSmallInt() + right.GetSmallInt());
+			return;
+		}
+		left = AddBigInts(left, right);
+	}
+
+	inline void SubtractInPlace(Value& left, const Value& right) {
+		if (Value::AreSmallInts(left, right)) {
+			left.AssignOverSmallInt(left.GetSmallInt() - right.GetSmallInt());
+			return;
+		}
+		left = SubtractBigInts(left, right);
+	}
+
+	inline void MultiplyInPlace(Value& left, const Value& right) {
+		int64_t product = 0;
+		if (Value::AreSmallInts(left, right) && !MultiplyOverflows(left.GetSmallInt(), right.GetSmallInt(), product)) {
+			left.AssignOverSmallInt(product);
+			return;
+		}
+		left = MultiplyBigInts(left, right);
+	}
+
+	inline void DivideInPlace(Value& left, const Value& right) {
+		if (IsZero(right)) {
+			throw std::runtime_error("integer division or modulo by zero");
+		}
+		if (Value::AreSmallInts(left, right)) {
+			left.AssignOverSmallInt(FloorDivide(left.GetSmallInt(), right.GetSmallInt()));
+			return;
+		}
+		left = DivideBigInts(left, right);
+	}
+
+	inline void ModuloInPlace(Value& left, const Value& right) {
+		if (IsZero(right)) {
+			throw std::runtime_error("integer modulo by zero");
+		}
+		if (Value::AreSmallInts(left, right)) {
+			left.AssignOverSmallInt(FloorModulo(left.GetSmallInt(), right.GetSmallInt()));
+			return;
+		}
+		left = ModuloBigInts(left, right);
+	}
+
+	inline void NegateInPlace(Value& value) {
+		if (value.IsSmallInt()) {
+			value.AssignOverSmallInt(-value.GetSmallInt());
+			return;
+		}
+		value = NegateBigInt(value);
+	}
+
+	// less than 0, 0, or greater than 0, as left is less than, equal to, or greater than right
+	inline int Compare(const Value& left, const Value& right) {
+		if (Value::AreSmallInts(left, right)) {
+			const int64_t left_int = left.GetSmallInt();
+			const int64_t right_int = right.GetSmallInt();
+			return (left_int > right_int) - (left_int < right_int);
+		}
+		return CompareBigInts(left, right);
+	}
+
+	// replaces left by whether it and right are ordered as predicate (e.g. std::less<>) says: 1 or 0, like python's True and False
+	template <typename Predicate>
+	void CompareInPlace(Value& left, const Value& right, Predicate predicate) {
+		if (Value::AreSmallInts(left, right)) {
+			left.AssignOverSmallInt(predicate(left.GetSmallInt(), right.GetSmallInt()));
+			return;
+		}
+		left.AssignInt(predicate(CompareBigInts(left, right), 0));
+	}
+}
+
+#endif
@@ -0,0 +1,391 @@
+#include "bigint.hpp"
+
+#include <span>
+#include <bit>
+#include <algorithm>
+#include <stdexcept>
+#include <cassert>
+
+namespace {
+	using Limbs = std::vector<uint32_t>;
+	using LimbSpan = std::span<const uint32_t>;
+
+	// below this many limbs (in the shorter operand), multiplying every pair of limbs is faster than splitting the operands (Karatsuba)
+	constexpr size_t karatsuba_threshold = 32;
+
+	void TrimLimbs(Limbs& limbs) {
+		while (!limbs.empty() && limbs.back() == 0) {
+			limbs.pop_back();
+		}
+	}
+	LimbSpan TrimLimbs(LimbSpan limbs) {
+		while (!limbs.empty() && limbs.back() == 0) {
+			limbs = limbs.first(limbs.size() - 1);
+		}
+		return limbs;
+	}
+
+	// magnitudes are trimmed
+	int CompareMagnitudes(LimbSpan left, LimbSpan right) {
+		if (left.size() != right.size()) {
+			return left.size() < right.size() ? -1 : 1;
+		}
+		for (size_t i = left.size(); i-- > 0;) {
+			if (left[i] != right[i]) {
+				return left[i] < right[i] ? -1 : 1;
+			}
+		}
+		return 0;
+	}
+
+	Limbs AddMagnitudes(LimbSpan left, LimbSpan right) {
+		if (left.size() < right.size()) {
+			std::swap(left, right);
+		}
+		Limbs sum(left.size() + 1);
+		uint64_t carry = 0;
+		for (size_t i = 0; i < left.size(); ++i) {
+			carry += uint64_t{ left[i] } + (i < right.size() ? right[i] : 0);
+			sum[i] = static_cast<uint32_t>(carry);
+			carry >>= 32;
+		}
+		sum.back() = static_cast<uint32_t>(carry);
+		TrimLimbs(sum);
+		return sum;
+	}
+
+	// left must be at least right
+	Limbs SubtractMagnitudes(LimbSpan left, LimbSpan right) {
+		Limbs difference(left.size());
+		uint64_t borrow = 0;
+		for (size_t i = 0; i < left.size(); ++i) {
+			const uint64_t limb_difference = uint64_t{ left[i] } - (i < right.size() ? right[i] : 0) - borrow;
+			difference[i] = static_cast<uint32_t>(limb_difference);
+			borrow = limb_difference >> 63;	// it wrapped around
+		}
+		assert(borrow == 0);
+		TrimLimbs(difference);
+		return difference;
+	}
+
+	// adds addend, shifted up by shift limbs, into sum (which must be large enough for the result)
+	void AddShifted(Limbs& sum, LimbSpan addend, size_t shift) {
+		uint64_t carry = 0;
+		size_t i = shift;
+		for (const uint32_t limb : addend) {
+			carry += uint64_t{ sum[i] } + limb;
+			sum[i++] = static_cast<uint32_t>(carry);
+			carry >>= 32;
+		}
+		for (; carry; ++i) {
+			assert(i < sum.size());
+			carry += sum[i];
+			sum[i] = static_cast<uint32_t>(carry);
+			carry >>= 32;
+		}
+	}
+
+	// subtracts subtrahend from difference in place (the result must not be negative)
+	void SubtractInPlace(Limbs& difference, LimbSpan subtrahend) {
+		uint64_t borrow = 0;
+		size_t i = 0;
+		for (; i < subtrahend.size(); ++i) {
+			const uint64_t limb_difference = uint64_t{ difference[i] } - subtrahend[i] - borrow;
+			difference[i] = static_cast<uint32_t>(limb_difference);
+			borrow = limb_difference >> 63;
+		}
+		for (; borrow; ++i) {
+			assert(i < difference.size());
+			const uint64_t limb_difference = uint64_t{ difference[i] } - borrow;
+			difference[i] = static_cast<uint32_t>(limb_difference);
+			borrow = limb_difference >> 63;
+		}
+		TrimLimbs(difference);
+	}
+
+	Limbs SchoolbookMultiply(LimbSpan left, LimbSpan right) {
+		Limbs product(left.size() + right.size());
+		for (size_t i = 0; i < left.size(); ++i) {
+			uint64_t carry = 0;
+			for (size_t j = 0; j < right.size(); ++j) {
+				// at most (2^32 - 1)^2 + 2 * (2^32 - 1), which fits
+				carry += uint64_t{ left[i] } * right[j] + product[i + j];
+				product[i + j] = static_cast<uint32_t>(carry);
+				carry >>= 32;
+			}
+			product[i + right.size()] = static_cast<uint32_t>(carry);
+		}
+		TrimLimbs(product);
+		return product;
+	}
+
+	// Karatsuba: with each operand split in halves (high * B + low), the product is
+	// high_product * B^2 + ((left_high + left_low) * (right_high + right_low) - high_product - low_product) * B + low_product,
+	// which is three multiplications of half the size rather than four.
+	Limbs MultiplyMagnitudes(LimbSpan left, LimbSpan right) {
+		left = TrimLimbs(left);
+		right = TrimLimbs(right);
+		if (left.size() < right.size()) {
+			std::swap(left, right);
+		}
+		if (right.size() < karatsuba_threshold) {
+			return SchoolbookMultiply(left, right);
+		}
+		const size_t half = (left.size() + 1) / 2;
+		Limbs product(left.size() + right.size());
+		if (right.size() <= half) {
+			// too unbalanced to split both: the longer operand is multiplied in halves
+			AddShifted(product, MultiplyMagnitudes(left.first(half), right), 0);
+			AddShifted(product, MultiplyMagnitudes(left.subspan(half), right), half);
+			TrimLimbs(product);
+			return product;
+		}
+		const LimbSpan left_low = left.first(half);
+		const LimbSpan left_high = left.subspan(half);
+		const LimbSpan right_low = right.first(half);
+		const LimbSpan right_high = right.subspan(half);
+		const Limbs low_product = MultiplyMagnitudes(left_low, right_low);
+		const Limbs high_product = MultiplyMagnitudes(left_high, right_high);
+		Limbs middle_product = MultiplyMagnitudes(AddMagnitudes(left_low, left_high), AddMagnitudes(right_low, right_high));
+		SubtractInPlace(middle_product, low_product);
+		SubtractInPlace(middle_product, high_product);
+		AddShifted(product, low_product, 0);
+		AddShifted(product, middle_product, half);
+		AddShifted(product, high_product, 2 * half);
+		TrimLimbs(product);
+		return product;
+	}
+
+	// limbs shifted up by shift bits (less than 32), with one more limb for what is shifted out
+	Limbs ShiftLimbsLeft(LimbSpan limbs, int shift) {
+		Limbs shifted(limbs.size() + 1);
+		uint32_t carry = 0;
+		for (size_t i = 0; i < limbs.size(); ++i) {
+			const uint64_t wide = (uint64_t{ limbs[i] } << shift) | carry;
+			shifted[i] = static_cast<uint32_t>(wide);
+			carry = static_cast<uint32_t>(wide >> 32);
+		}
+		shifted.back() = carry;
+		return shifted;
+	}
+
+	// the quotient and remainder of magnitudes (the divisor must not be zero), by long division (Knuth's algorithm D).
+	// each limb of the quotient is estimated from the top limbs, and corrected.
+	std::pair<Limbs, Limbs> DivideMagnitudes(LimbSpan dividend, LimbSpan divisor) {
+		assert(!divisor.empty());
+		if (CompareMagnitudes(dividend, divisor) < 0) {
+			return { Limbs{}, Limbs(std::begin(dividend), std::end(dividend)) };
+		}
+		if (divisor.size() == 1) {
+			Limbs quotient(dividend.size());
+			uint64_t remainder = 0;
+			for (size_t i = dividend.size(); i-- > 0;) {
+				remainder = (remainder << 32) | dividend[i];
+				quotient[i] = static_cast<uint32_t>(remainder / divisor[0]);
+				remainder %= divisor[0];
+			}
+			TrimLimbs(quotient);
+			return { std::move(quotient), remainder ? Limbs{ static_cast<uint32_t>(remainder) } : Limbs{} };
+		}
+
+		// normalized so that the divisor's top bit is set, which keeps each estimate at most 2 too large
+		const int shift = std::countl_zero(divisor.back());
+		Limbs remainder = ShiftLimbsLeft(dividend, shift);
+		Limbs normalized_divisor = ShiftLimbsLeft(divisor, shift);
+		normalized_divisor.pop_back();	// nothing is shifted out of it
+		const size_t n = normalized_divisor.size();
+		const uint64_t top = normalized_divisor[n - 1];
+		const uint64_t second = normalized_divisor[n - 2];
+		Limbs quotient(remainder.size() - n);
+		for (size_t j = quotient.size(); j-- > 0;) {
+			const uint64_t numerator = (uint64_t{ remainder[j + n] } << 32) | remainder[j + n - 1];
+			uint64_t estimate = numerator / top;
+			uint64_t estimate_remainder = numerator % top;
+			while (estimate > UINT32_MAX || estimate * second > ((estimate_remainder << 32) | remainder[j + n - 2])) {
+				--estimate;
+				estimate_remainder += top;
+				if (estimate_remainder > UINT32_MAX) {
+					break;
+				}
+			}
+			// subtract estimate * divisor from the current limbs
+			uint64_t carry = 0;
+			int64_t borrow = 0;
+			for (size_t i = 0; i < n; ++i) {
+				const uint64_t product = estimate * normalized_divisor[i] + carry;
+				carry = product >> 32;
+				const int64_t difference = int64_t{ remainder[i + j] } - borrow - static_cast<int64_t>(product & UINT32_MAX);
+				remainder[i + j] = static_cast<uint32_t>(difference);
+				borrow = difference < 0;
+			}
+			const int64_t difference = int64_t{ remainder[j + n] } - borrow - static_cast<int64_t>(carry);
+			remainder[j + n] = static_cast<uint32_t>(difference);
+			if (difference < 0) {
+				// the estimate was still one too large (rarely), so the divisor is added back
+				--estimate;
+				uint64_t add_carry = 0;
+				for (size_t i = 0; i < n; ++i) {
+					add_carry += uint64_t{ remainder[i + j] } + normalized_divisor[i];
+					remainder[i + j] = static_cast<uint32_t>(add_carry);
+					add_carry >>= 32;
+				}
+				remainder[j + n] += static_cast<uint32_t>(add_carry);
+			}
+			quotient[j] = static_cast<uint32_t>(estimate);
+		}
+		TrimLimbs(quotient);
+
+		// the remainder is in the low limbs, still shifted (the limbs above it are zero)
+		Limbs unshifted(n);
+		for (size_t i = 0; i < n; ++i) {
+			unshifted[i] = static_cast<uint32_t>(((uint64_t{ remainder[i + 1] } << 32) | remainder[i]) >> shift);
+		}
+		TrimLimbs(unshifted);
+		return { std::move(quotient), std::move(unshifted) };
+	}
+
+	// limbs = limbs * factor + addend, in place
+	void MultiplyAddLimb(Limbs& limbs, uint32_t factor, uint32_t addend) {
+		uint64_t carry = addend;
+		for (uint32_t& limb : limbs) {
+			carry += uint64_t{ limb } * factor;
+			limb = static_cast<uint32_t>(carry);
+			carry >>= 32;
+		}
+		if (carry) {
+			limbs.push_back(static_cast<uint32_t>(carry));
+		}
+	}
+}
+
+BigInt::BigInt(int64_t value) : is_negative(value < 0) {
+	// the magnitude is taken unsigned, as that of the smallest int64_t does not fit in one
+	const uint64_t value_magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+	magnitude = { static_cast<uint32_t>(value_magnitude), static_cast<uint32_t>(value_magnitude >> 32) };
+	TrimLimbs(magnitude);
+}
+
+BigInt::BigInt(std::vector<uint32_t> _magnitude, bool _is_negative) : magnitude(std::move(_magnitude)), is_negative(_is_negative) {
+	TrimLimbs(magnitude);
+	if (magnitude.empty()) {
+		is_negative = false;
+	}
+}
+
+BigInt BigInt::FromString(std::string_view digits) {
+	const bool negative = !digits.empty() && digits.front() == '-';
+	if (negative) {
+		digits.remove_prefix(1);
+	}
+	if (digits.empty() || !std::ranges::all_of(digits, [](char c) {return c >= '0' && c <= '9'; })) {
+		throw std::invalid_argument("invalid integer");
+	}
+	// nine digits at a time, the most that fit in a limb
+	Limbs limbs{};
+	limbs.reserve(digits.size() / 9 + 1);
+	while (!digits.empty()) {
+		const size_t chunk_size = std::min<size_t>(digits.size(), 9);
+		uint32_t chunk = 0;
+		uint32_t factor = 1;
+		for (const char c : digits.substr(0, chunk_size)) {
+			chunk = chunk * 10 + static_cast<uint32_t>(c - '0');
+			factor *= 10;
+		}
+		MultiplyAddLimb(limbs, factor, chunk);
+		digits.remove_prefix(chunk_size);
+	}
+	return BigInt(std::move(limbs), negative);
+}
+
+std::string BigInt::ToString() const {
+	if (magnitude.empty()) {
+		return "0";
+	}
+	// nine digits at a time, least significant first
+	std::vector<uint32_t> chunks{};
+	Limbs rest = magnitude;
+	while (!rest.empty()) {
+		uint64_t remainder = 0;
+		for (size_t i = rest.size(); i-- > 0;) {
+			remainder = (remainder << 32) | rest[i];
+			rest[i] = static_cast<uint32_t>(remainder / 1'000'000'000);
+			remainder %= 1'000'000'000;
+		}
+		TrimLimbs(rest);
+		chunks.push_back(static_cast<uint32_t>(remainder));
+	}
+	std::string digits = is_negative ? "-" : "";
+	digits += std::to_string(chunks.back());
+	for (size_t i = chunks.size() - 1; i-- > 0;) {
+		const std::string chunk = std::to_string(chunks[i]);
+		digits.append(9 - chunk.size(), '0');
+		digits += chunk;
+	}
+	return digits;
+}
+
+std::optional<int64_t> BigInt::ToInt64() const {
+	if (magnitude.size() > 2) {
+		return std::nullopt;
+	}
+	uint64_t value_magnitude = 0;
+	for (size_t i = magnitude.size(); i-- > 0;) {
+		value_magnitude = (value_magnitude << 32) | magnitude[i];
+	}
+	if (value_magnitude > uint64_t{ INT64_MAX } + is_negative) {
+		return std::nullopt;
+	}
+	return is_negative ? static_cast<int64_t>(0 - value_magnitude) : static_cast<int64_t>(value_magnitude);
+}
+
+bool BigInt::IsZero() const {
+	return magnitude.empty();
+}
+
+bool BigInt::IsNegative() const {
+	return is_negative;
+}
+
+BigInt BigInt::operator-() const {
+	return BigInt(magnitude, !is_negative);
+}
+
+BigInt operator+(const BigInt& left, const BigInt& right) {
+	if (left.is_negative == right.is_negative) {
+		return BigInt(AddMagnitudes(left.magnitude, right.magnitude), left.is_negative);
+	}
+	// the sign is that of the larger magnitude
+	if (CompareMagnitudes(left.magnitude, right.magnitude) >= 0) {
+		return BigInt(SubtractMagnitudes(left.magnitude, right.magnitude), left.is_negative);
+	}
+	return BigInt(SubtractMagnitudes(right.magnitude, left.magnitude), right.is_negative);
+}
+
+BigInt operator-(const BigInt& left, const BigInt& right) {
+	return left + -right;
+}
+
+BigInt operator*(const BigInt& left, const BigInt& right) {
+	return BigInt(MultiplyMagnitudes(left.magnitude, right.magnitude), left.is_negative != right.is_negative);
+}
+
+std::pair<BigInt, BigInt> BigInt::DivideModulo(const BigInt& dividend, const BigInt& divisor) {
+	assert(!divisor.IsZero());
+	auto [quotient_magnitude, remainder_magnitude] = DivideMagnitudes(dividend.magnitude, divisor.magnitude);
+	BigInt quotient(std::move(quotient_magnitude), dividend.is_negative != divisor.is_negative);
+	BigInt remainder(std::move(remainder_magnitude), dividend.is_negative);
+	// the division truncated; floor it
+	if (!remainder.IsZero() && dividend.is_negative != divisor.is_negative) {
+		quotient = quotient - BigInt(1);
+		remainder = remainder + divisor;
+	}
+	return { std::move(quotient), std::move(remainder) };
+}
+
+std::strong_ordering operator<=>(const BigInt& left, const BigInt& right) {
+	if (left.is_negative != right.is_negative) {
+		return left.is_negative ? std::strong_ordering::less : std::strong_ordering::greater;
+	}
+	const int comparison = left.is_negative ? CompareMagnitudes(right.magnitude, left.magnitude) : CompareMagnitudes(left.magnitude, right.magnitude);
+	return comparison <=> 0;
+}
@@ -0,0 +1,42 @@
+#ifndef BIGINT_HPP
+#define BIGINT_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <optional>
+#include <utility>
+#include <compare>
+
+// an integer of any size, for the values too large for Value to keep inline.
+// stored as a sign and a magnitude in 32-bit limbs, least significant first, with no leading zero limbs (so zero has none, and is never negative).
+class BigInt {
+public:
+	BigInt() = default;
+	explicit BigInt(int64_t value);
+	// decimal digits, with an optional '-'
+	static BigInt FromString(std::string_view digits);
+	std::string ToString() const;
+	// the value, if it fits in 64 bits
+	std::optional<int64_t> ToInt64() const;
+	bool IsZero() const;
+	bool IsNegative() const;
+
+	BigInt operator-() const;
+	friend BigInt operator+(const BigInt& left, const BigInt& right);
+	friend BigInt operator-(const BigInt& left, const BigInt& right);
+	friend BigInt operator*(const BigInt& left, const BigInt& right);
+	// floor division and its remainder, which takes the sign of the divisor (as in python). the divisor must not be zero.
+	static std::pair<BigInt, BigInt> DivideModulo(const BigInt& dividend, const BigInt& divisor);
+	friend bool operator==(const BigInt& left, const BigInt& right) = default;
+	friend std::strong_ordering operator<=>(const BigInt& left, const BigInt& right);
+private:
+	std::vector<uint32_t> magnitude{};
+	bool is_negative = false;
+
+	// trims leading zero limbs, and makes zero non-negative
+	BigInt(std::vector<uint32_t> _magnitude, bool _is_negative);
+};
+
+#endif
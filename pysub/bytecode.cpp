@@ -0,0 +1,500 @@
+#include "bytecode.hpp"
+#include "bigint.hpp"
+
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+/* Compiler */
+
+namespace {
+	// the change in the size of the stack, when an instruction does not jump
+	int GetStackEffect(OpCode op_code) {
+		switch (op_code) {
+		case OpCode::PushInteger:
+		case OpCode::PushConstant:
+		case OpCode::LoadName:
+		case OpCode::Duplicate:
+			return 1;
+		case OpCode::Swap:
+		case OpCode::RotateThree:
+		case OpCode::Negate:
+		case OpCode::Not:
+		case OpCode::Jump:
+		case OpCode::ReturnNone:
+			return 0;
+		case OpCode::StoreName:
+		case OpCode::Pop:
+		case OpCode::Add:
+		case OpCode::Subtract:
+		case OpCode::Multiply:
+		case OpCode::Divide:
+		case OpCode::Modulo:
+		case OpCode::Equal:
+		case OpCode::NotEqual:
+		case OpCode::Less:
+		case OpCode::LessEqual:
+		case OpCode::Greater:
+		case OpCode::GreaterEqual:
+		case OpCode::JumpIfFalseOrPop:
+		case OpCode::JumpIfTrueOrPop:
+		case OpCode::Return:
+			return -1;
+		}
+		throw std::invalid_argument("invalid op code");
+	}
+
+	// the number of values an instruction reads off the stack
+	int GetStackInputs(OpCode op_code) {
+		switch (op_code) {
+		case OpCode::PushInteger:
+		case OpCode::PushConstant:
+		case OpCode::LoadName:
+		case OpCode::Jump:
+		case OpCode::ReturnNone:
+			return 0;
+		case OpCode::StoreName:
+		case OpCode::Pop:
+		case OpCode::Duplicate:
+		case OpCode::Negate:
+		case OpCode::Not:
+		case OpCode::JumpIfFalseOrPop:
+		case OpCode::JumpIfTrueOrPop:
+		case OpCode::Return:
+			return 1;
+		case OpCode::Swap:
+		case OpCode::Add:
+		case OpCode::Subtract:
+		case OpCode::Multiply:
+		case OpCode::Divide:
+		case OpCode::Modulo:
+		case OpCode::Equal:
+		case OpCode::NotEqual:
+		case OpCode::Less:
+		case OpCode::LessEqual:
+		case OpCode::Greater:
+		case OpCode::GreaterEqual:
+			return 2;
+		case OpCode::RotateThree:
+			return 3;
+		}
+		throw std::invalid_argument("invalid op code");
+	}
+
+	OpCode GetBinaryOpCode(TokenKind kind) {
+		switch (kind) {
+		case TokenKind::Plus:
+			return OpCode::Add;
+		case TokenKind::Minus:
+			return OpCode::Subtract;
+		case TokenKind::Star:
+			return OpCode::Multiply;
+		case TokenKind::Slash:
+			return OpCode::Divide;
+		case TokenKind::Percent:
+			return OpCode::Modulo;
+		case TokenKind::Equal:
+			return OpCode::Equal;
+		case TokenKind::NotEqual:
+			return OpCode::NotEqual;
+		case TokenKind::Less:
+			return OpCode::Less;
+		case TokenKind::LessEqual:
+			return OpCode::LessEqual;
+		case TokenKind::Greater:
+			return OpCode::Greater;
+		case TokenKind::GreaterEqual:
+			return OpCode::GreaterEqual;
+		default:
+			throw std::invalid_argument("invalid binary operator");
+		}
+	}
+
+	std::string_view OpCodeToString(OpCode op_code) {
+		switch (op_code) {
+		case OpCode::PushInteger: return "PushInteger";
+		case OpCode::PushConstant: return "PushConstant";
+		case OpCode::LoadName: return "LoadName";
+		case OpCode::StoreName: return "StoreName";
+		case OpCode::Pop: return "Pop";
+		case OpCode::Duplicate: return "Duplicate";
+		case OpCode::Swap: return "Swap";
+		case OpCode::RotateThree: return "RotateThree";
+		case OpCode::Add: return "Add";
+		case OpCode::Subtract: return "Subtract";
+		case OpCode::Multiply: return "Multiply";
+		case OpCode::Divide: return "Divide";
+		case OpCode::Modulo: return "Modulo";
+		case OpCode::Negate: return "Negate";
+		case OpCode::Not: return "Not";
+		case OpCode::Equal: return "Equal";
+		case OpCode::NotEqual: return "NotEqual";
+		case OpCode::Less: return "Less";
+		case OpCode::LessEqual: return "LessEqual";
+		case OpCode::Greater: return "Greater";
+		case OpCode::GreaterEqual: return "GreaterEqual";
+		case OpCode::Jump: return "Jump";
+		case OpCode::JumpIfFalseOrPop: return "JumpIfFalseOrPop";
+		case OpCode::JumpIfTrueOrPop: return "JumpIfTrueOrPop";
+		case OpCode::Return: return "Return";
+		case OpCode::ReturnNone: return "ReturnNone";
+		}
+		throw std::invalid_argument("invalid op code");
+	}
+}
+
+// compiles a tree in one pass over its post-order: a node's operands are on the stack by the time it is reached,
+// so nesting needs no recursion (and has no limit). the stack size is tracked as instructions are emitted.
+// the only state carried between nodes is the jumps waiting for their targets, which are patched last in, first out:
+// those of 'and' and 'or' (emitted after the left operand), and those of the links of comparison chains.
+class Bytecode::Compiler {
+public:
+	explicit Compiler(Bytecode& _code, const FlatTree& _tree, Interner& _interner);
+	void CompileNode(uint32_t node_idx);
+	void Emit(OpCode op_code, uint32_t operand = 0);
+private:
+	// what a node's parent needs emitted after it
+	enum class Role : uint8_t {
+		None,
+		AndLeft,	// the left operand of an 'and'
+		OrLeft,	// the left operand of an 'or'
+		ChainLink,	// a comparison that is the left operand of another, so chains with it
+	};
+
+	Bytecode& code;
+	const FlatTree& tree;
+	Interner& interner;
+	std::vector<Role> roles{};
+	std::vector<size_t> jumps{};
+	int stack_size = 0;
+
+	// emits a jump whose target is set later by SetJumpTarget
+	size_t EmitJump(OpCode op_code);
+	void SetJumpTarget(size_t jump_idx);	// to the next instruction emitted
+	bool IsComparison(uint32_t node_idx) const;
+	void CompileComparison(uint32_t node_idx);
+	void CompileAtom(const Token& value);
+	SymbolId GetSymbol(const Token& name);
+};
+
+Bytecode::Compiler::Compiler(Bytecode& _code, const FlatTree& _tree, Interner& _interner)
+	: code(_code), tree(_tree), interner(_interner), roles(_tree.GetNodes().size(), Role::None) {
+	// parents come after their children, so roles are found in a pass of their own
+	for (uint32_t i = 0; i < tree.GetNodes().size(); ++i) {
+		if (tree.GetNodes()[i].kind != NodeKind::BinaryExpression) {
+			continue;
+		}
+		const uint32_t left = tree.GetLeftChild(i);
+		const TokenKind op = tree.GetToken(i).kind;
+		if (op == TokenKind::And || op == TokenKind::Or) {
+			roles[left] = op == TokenKind::And ? Role::AndLeft : Role::OrLeft;
+		}
+		else if (Utilities::IsComparison(op) && IsComparison(left)) {
+			roles[left] = Role::ChainLink;
+		}
+	}
+}
+
+void Bytecode::Compiler::CompileNode(uint32_t node_idx) {
+	const FlatTree::Node& node = tree.GetNodes()[node_idx];
+	switch (node.kind) {
+	case NodeKind::BinaryExpression: {
+		const TokenKind op = tree.GetToken(node_idx).kind;
+		if (op == TokenKind::And || op == TokenKind::Or) {
+			// the right operand is skipped if the left one decides (see Role::AndLeft), and either is the value, as in python
+			SetJumpTarget(jumps.back());
+			jumps.pop_back();
+		}
+		else if (Utilities::IsComparison(op)) {
+			CompileComparison(node_idx);
+		}
+		else {
+			Emit(GetBinaryOpCode(op));
+		}
+		break;
+	}
+	case NodeKind::UnaryExpression:
+		switch (tree.GetToken(node_idx).kind) {
+		case TokenKind::Plus:
+			// the value is unchanged
+			break;
+		case TokenKind::Minus:
+			Emit(OpCode::Negate);
+			break;
+		case TokenKind::Not:
+			Emit(OpCode::Not);
+			break;
+		default:
+			throw std::invalid_argument("invalid unary operator");
+		}
+		break;
+	case NodeKind::Grouping:
+		break;
+	case NodeKind::Atom:
+		CompileAtom(tree.GetToken(node_idx));
+		break;
+	case NodeKind::Assignment:
+		Emit(OpCode::StoreName, GetSymbol(tree.GetToken(node_idx)));
+		break;
+	}
+
+	switch (roles[node_idx]) {
+	case Role::None:
+	case Role::ChainLink:
+		break;
+	case Role::AndLeft:
+		jumps.push_back(EmitJump(OpCode::JumpIfFalseOrPop));
+		break;
+	case Role::OrLeft:
+		jumps.push_back(EmitJump(OpCode::JumpIfTrueOrPop));
+		break;
+	}
+}
+
+void Bytecode::Compiler::Emit(OpCode op_code, uint32_t operand) {
+	if (code.instructions.size() >= std::numeric_limits<uint32_t>::max()) {
+		throw std::length_error("code is too large to index with 32-bit indices");
+	}
+	code.instructions.push_back({ op_code, operand });
+	stack_size += GetStackEffect(op_code);
+	code.max_stack_size = std::max(code.max_stack_size, static_cast<uint32_t>(stack_size));
+}
+
+size_t Bytecode::Compiler::EmitJump(OpCode op_code) {
+	Emit(op_code);
+	return code.instructions.size() - 1;
+}
+
+void Bytecode::Compiler::SetJumpTarget(size_t jump_idx) {
+	code.instructions[jump_idx].operand = static_cast<uint32_t>(code.instructions.size());
+}
+
+bool Bytecode::Compiler::IsComparison(uint32_t node_idx) const {
+	return tree.GetNodes()[node_idx].kind == NodeKind::BinaryExpression && Utilities::IsComparison(tree.GetToken(node_idx).kind);
+}
+
+void Bytecode::Compiler::CompileComparison(uint32_t node_idx) {
+	// comparisons chain as in python: "a < b < c" means "a < b and b < c", with b evaluated once.
+	// a parenthesized comparison is a grouping, which does not chain.
+	// every link but the last keeps a copy of its right operand under its result, for the next comparison.
+	// a false result skips the rest, and is left on the stack once the copy under it is removed.
+	const OpCode op_code = GetBinaryOpCode(tree.GetToken(node_idx).kind);
+	if (roles[node_idx] == Role::ChainLink) {
+		Emit(OpCode::Duplicate);
+		Emit(OpCode::RotateThree);
+		Emit(op_code);
+		jumps.push_back(EmitJump(OpCode::JumpIfFalseOrPop));
+		return;
+	}
+	Emit(op_code);
+	if (!IsComparison(tree.GetLeftChild(node_idx))) {
+		return;	// not a chain
+	}
+
+	// the last link: the jumps of the links before it are the latest waiting, as each was followed by a whole operand
+	const size_t end_jump = EmitJump(OpCode::Jump);
+	for (uint32_t link = tree.GetLeftChild(node_idx); IsComparison(link); link = tree.GetLeftChild(link)) {
+		SetJumpTarget(jumps.back());
+		jumps.pop_back();
+	}
+	++stack_size;	// a jump here keeps both the copy and the result
+	Emit(OpCode::Swap);
+	Emit(OpCode::Pop);
+	SetJumpTarget(end_jump);
+}
+
+void Bytecode::Compiler::CompileAtom(const Token& value) {
+	if (value.category == Category::NumericLiteral) {
+		const int64_t* integer = std::get_if<int64_t>(&value.value);
+		if (integer && *integer >= std::numeric_limits<int32_t>::min() && *integer <= std::numeric_limits<int32_t>::max()) {
+			Emit(OpCode::PushInteger, static_cast<uint32_t>(*integer));
+			return;
+		}
+		Emit(OpCode::PushConstant, static_cast<uint32_t>(code.constants.size()));
+		code.constants.push_back(Utilities::GetLiteralValue(value));
+		return;
+	}
+	assert(value.category == Category::Identifier);
+	Emit(OpCode::LoadName, GetSymbol(value));
+}
+
+SymbolId Bytecode::Compiler::GetSymbol(const Token& name) {
+	// tokens lexed without an interner (e.g. built by hand) are interned by name
+	return name.symbol != no_symbol ? name.symbol : interner.Intern(std::get<std::string_view>(name.value));
+}
+
+/* Bytecode functions */
+
+Bytecode Bytecode::Compile(const FlatTree& tree, Interner& interner) {
+	// the value of the last statement is returned if it is an expression (as the python interpreter echoes it); others are discarded
+	Bytecode code{};
+	Compiler compiler(code, tree, interner);
+	const std::vector<uint32_t>& roots = tree.GetRoots();
+	uint32_t node_idx = 0;
+	for (size_t i = 0; i < roots.size(); ++i) {
+		code.statement_starts.push_back(static_cast<uint32_t>(code.instructions.size()));
+		for (; node_idx <= roots[i]; ++node_idx) {
+			compiler.CompileNode(node_idx);
+		}
+		if (tree.GetNodes()[roots[i]].kind != NodeKind::Assignment) {
+			compiler.Emit(i + 1 == roots.size() ? OpCode::Return : OpCode::Pop);
+		}
+	}
+	if (roots.empty() || tree.GetNodes()[roots.back()].kind == NodeKind::Assignment) {
+		compiler.Emit(OpCode::ReturnNone);
+	}
+	return code;
+}
+
+const std::vector<Instruction>& Bytecode::GetInstructions() const {
+	return instructions;
+}
+const std::vector<Value>& Bytecode::GetConstants() const {
+	return constants;
+}
+
+uint32_t Bytecode::GetMaxStackSize() const {
+	return max_stack_size;
+}
+
+Bytecode Bytecode::Deserialize(BinaryReader& reader, size_t symbol_count) {
+	Bytecode code{};
+	const uint64_t instruction_count = reader.Read<uint64_t>();
+	if (instruction_count > std::numeric_limits<uint32_t>::max() || instruction_count > reader.GetRemaining() / (sizeof(uint8_t) + sizeof(uint32_t))) {
+		throw std::runtime_error("invalid bytecode");
+	}
+	code.instructions.reserve(static_cast<size_t>(instruction_count));
+	for (uint64_t i = 0; i < instruction_count; ++i) {
+		const uint8_t op_code = reader.Read<uint8_t>();
+		if (op_code >= op_code_count) {
+			throw std::runtime_error("invalid bytecode");
+		}
+		code.instructions.push_back({ static_cast<OpCode>(op_code), reader.Read<uint32_t>() });
+	}
+	const uint64_t constant_count = reader.Read<uint64_t>();
+	for (uint64_t i = 0; i < constant_count; ++i) {
+		code.constants.emplace_back(BigInt::FromString(reader.ReadString()));	// throws if it is not an int
+	}
+	code.statement_starts = reader.ReadVector<uint32_t>();
+	code.max_stack_size = reader.Read<uint32_t>();
+	code.Verify(symbol_count);
+	return code;
+}
+
+void Bytecode::Serialize(BinaryWriter& writer) const {
+	// field by field, as an instruction has padding
+	writer.Write(static_cast<uint64_t>(instructions.size()));
+	for (const Instruction& instruction : instructions) {
+		writer.Write(static_cast<uint8_t>(instruction.op_code));
+		writer.Write(instruction.operand);
+	}
+	// constants are written in decimal, as they can be of any size
+	writer.Write(static_cast<uint64_t>(constants.size()));
+	for (const Value& constant : constants) {
+		writer.WriteString(constant.ToString());
+	}
+	writer.WriteVector(statement_starts);
+	writer.Write(max_stack_size);
+}
+
+void Bytecode::Verify(size_t symbol_count) const {
+	// follows the stack through the code, as the compiler did: jumps only go forward, and code after a jump or return is only reached by a jump.
+	// checks that operands are in range, that the stack stays within its size, and that the code cannot run off its end.
+	auto Fail = []() {
+		throw std::runtime_error("invalid bytecode");
+	};
+	constexpr int64_t unreached = -1;
+	std::vector<int64_t> jump_stack_sizes(instructions.size(), unreached);	// the stack size at each jump target
+	int64_t stack_size = 0;
+	int64_t largest_stack_size = 0;	// must be the size given, which the virtual machine allocates
+	for (size_t i = 0; i < instructions.size(); ++i) {
+		if (jump_stack_sizes[i] != unreached) {
+			if (stack_size != unreached && stack_size != jump_stack_sizes[i]) {
+				Fail();
+			}
+			stack_size = jump_stack_sizes[i];
+		}
+		if (stack_size == unreached) {
+			Fail();
+		}
+		const Instruction& instruction = instructions[i];
+		switch (instruction.op_code) {
+		case OpCode::PushConstant:
+			if (instruction.operand >= constants.size()) {
+				Fail();
+			}
+			break;
+		case OpCode::LoadName:
+		case OpCode::StoreName:
+			if (instruction.operand >= symbol_count) {
+				Fail();
+			}
+			break;
+		case OpCode::Jump:
+		case OpCode::JumpIfFalseOrPop:
+		case OpCode::JumpIfTrueOrPop: {
+			if (instruction.operand <= i || instruction.operand >= instructions.size()) {
+				Fail();
+			}
+			int64_t& target_stack_size = jump_stack_sizes[instruction.operand];
+			if (target_stack_size != unreached && target_stack_size != stack_size) {
+				Fail();
+			}
+			target_stack_size = stack_size;	// a conditional jump keeps the value it tested
+			break;
+		}
+		default:
+			break;
+		}
+		if (stack_size < GetStackInputs(instruction.op_code)) {
+			Fail();
+		}
+		stack_size += GetStackEffect(instruction.op_code);
+		largest_stack_size = std::max(largest_stack_size, stack_size);
+		if (instruction.op_code == OpCode::Jump || instruction.op_code == OpCode::Return || instruction.op_code == OpCode::ReturnNone) {
+			stack_size = unreached;
+		}
+	}
+	if (stack_size != unreached || largest_stack_size != max_stack_size) {
+		Fail();	// (the last instruction must not fall through)
+	}
+	if (!std::ranges::is_sorted(statement_starts) || (!statement_starts.empty() && statement_starts.back() >= instructions.size())) {
+		Fail();
+	}
+}
+
+std::string Bytecode::Disassemble(const Interner& interner) const {
+	std::ostringstream stream{};
+	size_t statement_idx = 0;
+	for (size_t i = 0; i < instructions.size(); ++i) {
+		if (statement_idx < statement_starts.size() && statement_starts[statement_idx] == i) {
+			stream << "statement " << ++statement_idx << ":\n";
+		}
+		const Instruction& instruction = instructions[i];
+		stream << '\t' << std::right << std::setw(4) << i << ' ';
+		switch (instruction.op_code) {
+		case OpCode::PushInteger:
+			stream << std::left << std::setw(18) << OpCodeToString(instruction.op_code) << static_cast<int32_t>(instruction.operand);
+			break;
+		case OpCode::PushConstant:
+			stream << std::left << std::setw(18) << OpCodeToString(instruction.op_code) << constants[instruction.operand];
+			break;
+		case OpCode::LoadName:
+		case OpCode::StoreName:
+			stream << std::left << std::setw(18) << OpCodeToString(instruction.op_code) << interner.GetName(instruction.operand);
+			break;
+		case OpCode::Jump:
+		case OpCode::JumpIfFalseOrPop:
+		case OpCode::JumpIfTrueOrPop:
+			stream << std::left << std::setw(18) << OpCodeToString(instruction.op_code) << "to " << instruction.operand;
+			break;
+		default:
+			stream << OpCodeToString(instruction.op_code);
+			break;
+		}
+		stream << '\n';
+	}
+	return std::move(stream).str();
+}
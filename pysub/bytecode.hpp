@@ -0,0 +1,79 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include "globals.hpp"
+#include "flat_tree.hpp"
+#include "interner.hpp"
+#include "serialization.hpp"
+
+#include <string>
+#include <vector>
+
+// instructions for a stack machine: operands are popped off a stack of values, and results are pushed onto it.
+// note: the virtual machine's dispatch table lists these in order! (add new ones before ReturnNone, and to the table)
+enum class OpCode : uint8_t {
+	PushInteger,	// operand: the value (an int32_t)
+	PushConstant,	// operand: the index of the value among the code's constants (for ints too large for an operand)
+	LoadName,	// operand: the symbol id, which is the variable's slot (see SymbolTable)
+	StoreName,	// operand: the symbol id. pops the value stored
+	Pop,
+	Duplicate,
+	Swap,	// the top two values
+	RotateThree,	// moves the top value down two places
+	Add,
+	Subtract,
+	Multiply,
+	Divide,
+	Modulo,
+	Negate,
+	Not,
+	Equal,
+	NotEqual,
+	Less,
+	LessEqual,
+	Greater,
+	GreaterEqual,
+	Jump,	// operand: the index of the instruction jumped to
+	JumpIfFalseOrPop,	// jumps if the top value is false (keeping it), otherwise pops it
+	JumpIfTrueOrPop,	// jumps if the top value is true (keeping it), otherwise pops it
+	Return,	// pops the value of the code
+	ReturnNone
+};
+constexpr size_t op_code_count = static_cast<size_t>(OpCode::ReturnNone) + 1;
+
+struct Instruction {
+	OpCode op_code;
+	uint32_t operand = 0;
+};
+
+// a tree compiled into a flat list of instructions, run by Execution::RunBytecode.
+// it views into nothing, so it outlives the tree and the text it was compiled from.
+// names are compiled to the symbol ids of the interner given to Compile, and must be run with (a copy of) that interner.
+class Bytecode {
+public:
+	Bytecode() = default;
+	// identifiers lexed without an interner are interned on compiling
+	static Bytecode Compile(const FlatTree& tree, Interner& interner);
+
+	const std::vector<Instruction>& GetInstructions() const;
+	const std::vector<Value>& GetConstants() const;
+	// how many values the stack must have room for
+	uint32_t GetMaxStackSize() const;
+	// one instruction per line, with each statement's instructions headed by its number (e.g. "statement 1:")
+	std::string Disassemble(const Interner& interner) const;
+
+	// code as written by Serialize, for an interner of symbol_count names.
+	// it is verified as it is read (throwing if it is invalid), as the virtual machine trusts its code not to run out of bounds.
+	static Bytecode Deserialize(BinaryReader& reader, size_t symbol_count);
+	void Serialize(BinaryWriter& writer) const;
+private:
+	std::vector<Instruction> instructions{};
+	std::vector<Value> constants{};
+	std::vector<uint32_t> statement_starts{};	// the index of each statement's first instruction
+	uint32_t max_stack_size = 0;
+
+	class Compiler;
+	void Verify(size_t symbol_count) const;
+};
+
+#endif
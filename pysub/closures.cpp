@@ -0,0 +1,442 @@
+#include "closures.hpp"
+#include "arithmetic.hpp"
+
+#include <cassert>
+
+/* Compiler */
+
+// builds closures in one pass over the tree's post-order, keeping a stack of the operands built so far, as a machine keeps values.
+// groupings and unary '+' are compiled away, as they leave the value unchanged. the functions closures call are captureless
+// lambdas (and templates), chosen once, on compiling.
+// running closures recurses once per level of nesting, so a left-associative chain ("a + b - c", "a and b or c", or "a < b < c")
+// is one closure that runs its links in a loop, however long it is. nesting deeper than max_depth (as in "a + (b + (c + ...)))")
+// is rejected on compiling, rather than overflowing the native stack on running.
+class ClosureCode::Compiler {
+public:
+	explicit Compiler(Arena& _arena, std::deque<Value>& _constants, const FlatTree& _tree, Interner& _interner);
+	void CompileNode(uint32_t node_idx);
+	// the closure of the statement whose root was compiled last
+	const Closure* TakeStatement();
+private:
+	static constexpr size_t max_depth = 1000;
+
+	// what an operand can still become, as its parent is compiled
+	enum class OperandKind : uint8_t {
+		Plain,
+		Operation,	// one arithmetic operator, 'and', or 'or', which its parent can extend into a chain
+		OperatorChain,
+		ComparisonChain,
+	};
+	struct Operand {
+		Closure* closure = nullptr;	// null for a literal not yet needed as a closure
+		const Value* constant = nullptr;	// of a literal
+		OperandKind kind = OperandKind::Plain;
+		TokenKind op{};	// of an operation
+		Closure* last_link = nullptr;	// of a chain
+		size_t depth = 1;	// of the closures called in running it
+	};
+	// the functions of an arithmetic operator, 'and', or 'or', for each way it is compiled
+	struct Operator {
+		Value (*closures)(const Closure& self, Context& context);
+		Value (*constant)(const Closure& self, Context& context);	// with a constant right operand (null if it is not bound)
+		Value (*apply_closure)(const Value& left, const Closure& link, Context& context);	// as a link of a chain
+		Value (*apply_constant)(const Value& left, const Closure& link, Context& context);
+	};
+
+	Arena& arena;
+	std::deque<Value>& constants;
+	const FlatTree& tree;
+	Interner& interner;
+	std::vector<Operand> operands{};
+
+	template <TokenKind op>
+	static Value Calculate(const Value& left, const Value& right);
+	template <TokenKind op>
+	static Value CalculateClosures(const Closure& self, Context& context);
+	template <TokenKind op>
+	static Value CalculateConstant(const Closure& self, Context& context);
+	template <TokenKind op>
+	static Value ApplyClosure(const Value& left, const Closure& link, Context& context);
+	template <TokenKind op>
+	static Value ApplyConstant(const Value& left, const Closure& link, Context& context);
+	template <TokenKind op>
+	static constexpr Operator MakeArithmetic();
+	static Operator GetOperator(TokenKind kind);
+	static bool (*GetComparison(TokenKind kind))(const Value&, const Value&);
+
+	void Push(const Operand& operand);
+	Operand Pop();
+	const Closure* GetClosure(Operand& operand);
+	// a link holding right, bound as a constant if it can be
+	Closure* MakeLink(const Operator& functions, Operand& right);
+	void CompileBinary(TokenKind op);
+	void CompileComparison(TokenKind op);
+	void CompileUnary(TokenKind op);
+	void CompileAtom(const Token& value);
+	void CompileAssignment(const Token& name);
+	SymbolId GetSymbol(const Token& name);
+};
+
+ClosureCode::Compiler::Compiler(Arena& _arena, std::deque<Value>& _constants, const FlatTree& _tree, Interner& _interner)
+	: arena(_arena), constants(_constants), tree(_tree), interner(_interner) {}
+
+void ClosureCode::Compiler::CompileNode(uint32_t node_idx) {
+	const FlatTree::Node& node = tree.GetNodes()[node_idx];
+	switch (node.kind) {
+	case NodeKind::BinaryExpression: {
+		const TokenKind op = tree.GetToken(node_idx).kind;
+		if (Utilities::IsComparison(op)) {
+			CompileComparison(op);
+		}
+		else {
+			CompileBinary(op);
+		}
+		break;
+	}
+	case NodeKind::UnaryExpression:
+		CompileUnary(tree.GetToken(node_idx).kind);
+		break;
+	case NodeKind::Grouping:
+		// a parenthesized operation is not extended by the operator after it (and a parenthesized comparison does not chain)
+		operands.back().kind = OperandKind::Plain;
+		break;
+	case NodeKind::Atom:
+		CompileAtom(tree.GetToken(node_idx));
+		break;
+	case NodeKind::Assignment:
+		CompileAssignment(tree.GetToken(node_idx));
+		break;
+	}
+}
+
+const ClosureCode::Closure* ClosureCode::Compiler::TakeStatement() {
+	assert(operands.size() == 1);
+	Operand statement = Pop();
+	return GetClosure(statement);
+}
+
+template <TokenKind op>
+Value ClosureCode::Compiler::Calculate(const Value& left, const Value& right) {
+	if constexpr (op == TokenKind::Plus) {
+		return Arithmetic::Add(left, right);
+	}
+	else if constexpr (op == TokenKind::Minus) {
+		return Arithmetic::Subtract(left, right);
+	}
+	else if constexpr (op == TokenKind::Star) {
+		return Arithmetic::Multiply(left, right);
+	}
+	else if constexpr (op == TokenKind::Slash) {
+		return Arithmetic::Divide(left, right);
+	}
+	else {
+		static_assert(op == TokenKind::Percent);
+		return Arithmetic::Modulo(left, right);
+	}
+}
+
+template <TokenKind op>
+Value ClosureCode::Compiler::CalculateClosures(const Closure& self, Context& context) {
+	const Value left = self.left->function(*self.left, context);
+	return Calculate<op>(left, self.right->function(*self.right, context));
+}
+
+template <TokenKind op>
+Value ClosureCode::Compiler::CalculateConstant(const Closure& self, Context& context) {
+	return Calculate<op>(self.left->function(*self.left, context), *self.constant);
+}
+
+template <TokenKind op>
+Value ClosureCode::Compiler::ApplyClosure(const Value& left, const Closure& link, Context& context) {
+	return Calculate<op>(left, link.left->function(*link.left, context));
+}
+
+template <TokenKind op>
+Value ClosureCode::Compiler::ApplyConstant(const Value& left, const Closure& link, Context&) {
+	return Calculate<op>(left, *link.constant);
+}
+
+template <TokenKind op>
+constexpr ClosureCode::Compiler::Operator ClosureCode::Compiler::MakeArithmetic() {
+	return { &CalculateClosures<op>, &CalculateConstant<op>, &ApplyClosure<op>, &ApplyConstant<op> };
+}
+
+ClosureCode::Compiler::Operator ClosureCode::Compiler::GetOperator(TokenKind kind) {
+	switch (kind) {
+	case TokenKind::Plus:
+		return MakeArithmetic<TokenKind::Plus>();
+	case TokenKind::Minus:
+		return MakeArithmetic<TokenKind::Minus>();
+	case TokenKind::Star:
+		return MakeArithmetic<TokenKind::Star>();
+	case TokenKind::Slash:
+		return MakeArithmetic<TokenKind::Slash>();
+	case TokenKind::Percent:
+		return MakeArithmetic<TokenKind::Percent>();
+	case TokenKind::And:
+		// as in python, 'and' and 'or' give the operand that decided the result, and skip the right operand if it is not needed
+		return {
+			[](const Closure& self, Context& context) {
+				Value left = self.left->function(*self.left, context);
+				return !Arithmetic::IsZero(left) ? self.right->function(*self.right, context) : left;
+			},
+			nullptr,
+			[](const Value& left, const Closure& link, Context& context) {
+				return !Arithmetic::IsZero(left) ? link.left->function(*link.left, context) : left;
+			},
+			nullptr,
+		};
+	case TokenKind::Or:
+		return {
+			[](const Closure& self, Context& context) {
+				Value left = self.left->function(*self.left, context);
+				return !Arithmetic::IsZero(left) ? left : self.right->function(*self.right, context);
+			},
+			nullptr,
+			[](const Value& left, const Closure& link, Context& context) {
+				return !Arithmetic::IsZero(left) ? left : link.left->function(*link.left, context);
+			},
+			nullptr,
+		};
+	default:
+		throw std::invalid_argument("invalid binary operator");
+	}
+}
+
+bool (*ClosureCode::Compiler::GetComparison(TokenKind kind))(const Value&, const Value&) {
+	switch (kind) {
+	case TokenKind::Equal:
+		return [](const Value& left, const Value& right) {return Arithmetic::Compare(left, right) == 0; };
+	case TokenKind::NotEqual:
+		return [](const Value& left, const Value& right) {return Arithmetic::Compare(left, right) != 0; };
+	case TokenKind::Less:
+		return [](const Value& left, const Value& right) {return Arithmetic::Compare(left, right) < 0; };
+	case TokenKind::LessEqual:
+		return [](const Value& left, const Value& right) {return Arithmetic::Compare(left, right) <= 0; };
+	case TokenKind::Greater:
+		return [](const Value& left, const Value& right) {return Arithmetic::Compare(left, right) > 0; };
+	case TokenKind::GreaterEqual:
+		return [](const Value& left, const Value& right) {return Arithmetic::Compare(left, right) >= 0; };
+	default:
+		return nullptr;
+	}
+}
+
+void ClosureCode::Compiler::Push(const Operand& operand) {
+	if (operand.depth > max_depth) {
+		throw std::runtime_error("maximum recursion depth exceeded");
+	}
+	operands.push_back(operand);
+}
+
+ClosureCode::Compiler::Operand ClosureCode::Compiler::Pop() {
+	const Operand operand = operands.back();
+	operands.pop_back();
+	return operand;
+}
+
+const ClosureCode::Closure* ClosureCode::Compiler::GetClosure(Operand& operand) {
+	if (!operand.closure) {
+		Closure* closure = arena.Make<Closure>();
+		closure->constant = operand.constant;
+		closure->function = [](const Closure& self, Context&) {
+			return *self.constant;
+		};
+		operand.closure = closure;
+	}
+	return operand.closure;
+}
+
+ClosureCode::Closure* ClosureCode::Compiler::MakeLink(const Operator& functions, Operand& right) {
+	Closure* link = arena.Make<Closure>();
+	if (!right.closure && functions.apply_constant) {
+		link->constant = right.constant;
+		link->apply = functions.apply_constant;
+	}
+	else {
+		link->left = GetClosure(right);
+		link->apply = functions.apply_closure;
+	}
+	return link;
+}
+
+void ClosureCode::Compiler::CompileBinary(TokenKind op) {
+	const Operator functions = GetOperator(op);
+	Operand right = Pop();
+	Operand left = Pop();
+	if (left.kind == OperandKind::Operation) {
+		// the left operand becomes the first link of a chain: "a + b" then runs as "a", then "+ b"
+		Closure* closure = left.closure;
+		const Operator left_functions = GetOperator(left.op);
+		Closure* link = arena.Make<Closure>();
+		if (closure->constant) {
+			link->constant = closure->constant;
+			link->apply = left_functions.apply_constant;
+			closure->constant = nullptr;
+		}
+		else {
+			link->left = closure->right;
+			link->apply = left_functions.apply_closure;
+		}
+		closure->right = link;
+		closure->function = [](const Closure& self, Context& context) {
+			Value value = self.left->function(*self.left, context);
+			for (const Closure* next = self.right; next; next = next->right) {
+				value = next->apply(value, *next, context);
+			}
+			return value;
+		};
+		left.kind = OperandKind::OperatorChain;
+		left.last_link = link;
+	}
+	if (left.kind == OperandKind::OperatorChain) {
+		Closure* link = MakeLink(functions, right);
+		left.last_link->right = link;
+		left.last_link = link;
+		left.depth = std::max(left.depth, right.depth + 1);
+		Push(left);
+		return;
+	}
+
+	Closure* closure = arena.Make<Closure>();
+	closure->left = GetClosure(left);
+	// a constant right operand (as in "x * 2") is bound into the closure itself, saving a call
+	if (!right.closure && functions.constant) {
+		closure->constant = right.constant;
+		closure->function = functions.constant;
+	}
+	else {
+		closure->right = GetClosure(right);
+		closure->function = functions.closures;
+	}
+	Push({ .closure = closure, .kind = OperandKind::Operation, .op = op, .depth = std::max(left.depth, right.depth) + 1 });
+}
+
+void ClosureCode::Compiler::CompileComparison(TokenKind op) {
+	// comparisons chain as in python: "a < b < c" means "a < b and b < c", with b evaluated once.
+	// a chain is compiled to its first operand and a list of links, each holding a comparison and the operand to its right.
+	Operand right = Pop();
+	Operand left = Pop();
+	Closure* link = arena.Make<Closure>();
+	link->left = GetClosure(right);
+	link->compare = GetComparison(op);
+	if (left.kind == OperandKind::ComparisonChain) {
+		left.last_link->right = link;
+		left.last_link = link;
+		left.depth = std::max(left.depth, right.depth + 1);
+		Push(left);
+		return;
+	}
+
+	Closure* closure = arena.Make<Closure>();
+	closure->left = GetClosure(left);
+	closure->right = link;
+	closure->function = [](const Closure& self, Context& context) {
+		Value left_value = self.left->function(*self.left, context);
+		for (const Closure* next = self.right; next; next = next->right) {
+			Value right_value = next->left->function(*next->left, context);
+			if (!next->compare(left_value, right_value)) {
+				return Value{ 0 };
+			}
+			left_value = std::move(right_value);
+		}
+		return Value{ 1 };
+	};
+	Push({ .closure = closure, .kind = OperandKind::ComparisonChain, .last_link = link, .depth = std::max(left.depth, right.depth) + 1 });
+}
+
+void ClosureCode::Compiler::CompileUnary(TokenKind op) {
+	Operand operand = Pop();
+	if (op == TokenKind::Plus) {
+		operand.kind = OperandKind::Plain;
+		Push(operand);
+		return;
+	}
+	Closure* closure = arena.Make<Closure>();
+	closure->left = GetClosure(operand);
+	switch (op) {
+	case TokenKind::Minus:
+		closure->function = [](const Closure& self, Context& context) {
+			return Arithmetic::Negate(self.left->function(*self.left, context));
+		};
+		break;
+	case TokenKind::Not:
+		closure->function = [](const Closure& self, Context& context) {
+			return Value{ Arithmetic::IsZero(self.left->function(*self.left, context)) };
+		};
+		break;
+	default:
+		throw std::invalid_argument("invalid unary operator");
+	}
+	Push({ .closure = closure, .depth = operand.depth + 1 });
+}
+
+void ClosureCode::Compiler::CompileAtom(const Token& value) {
+	if (value.category == Category::NumericLiteral) {
+		// made a closure only if it is not bound into its parent
+		Push({ .constant = &constants.emplace_back(Utilities::GetLiteralValue(value)) });
+		return;
+	}
+	assert(value.category == Category::Identifier);
+	Closure* closure = arena.Make<Closure>();
+	closure->symbol = GetSymbol(value);
+	closure->function = [](const Closure& self, Context& context) {
+		const Value* found = context.symbol_table.Find(self.symbol);
+		if (!found) {
+			throw std::runtime_error("name '" + std::string{ context.interner.GetName(self.symbol) } + "' is not defined");
+		}
+		if (!found->IsInt()) {
+			throw std::runtime_error("unsupported operand type: str");
+		}
+		return *found;
+	};
+	Push({ .closure = closure });
+}
+
+void ClosureCode::Compiler::CompileAssignment(const Token& name) {
+	// returns the value assigned
+	Operand value = Pop();
+	Closure* closure = arena.Make<Closure>();
+	closure->left = GetClosure(value);
+	closure->symbol = GetSymbol(name);
+	closure->function = [](const Closure& self, Context& context) {
+		Value assigned = self.left->function(*self.left, context);
+		context.symbol_table.Assign(self.symbol, assigned);
+		return assigned;
+	};
+	Push({ .closure = closure, .depth = value.depth + 1 });
+}
+
+SymbolId ClosureCode::Compiler::GetSymbol(const Token& name) {
+	// tokens lexed without an interner (e.g. built by hand) are interned by name
+	return name.symbol != no_symbol ? name.symbol : interner.Intern(std::get<std::string_view>(name.value));
+}
+
+/* ClosureCode functions */
+
+ClosureCode ClosureCode::Compile(const FlatTree& tree, Interner& interner) {
+	ClosureCode code{};
+	Compiler compiler(code.arena, code.constants, tree, interner);
+	const std::vector<uint32_t>& roots = tree.GetRoots();
+	uint32_t node_idx = 0;
+	for (const uint32_t root : roots) {
+		for (; node_idx <= root; ++node_idx) {
+			compiler.CompileNode(node_idx);
+		}
+		code.statements.push_back(compiler.TakeStatement());
+	}
+	code.returns_value = !roots.empty() && tree.GetNodes()[roots.back()].kind != NodeKind::Assignment;
+	return code;
+}
+
+std::optional<Value> ClosureCode::Run(SymbolTable& symbol_table, const Interner& interner) const {
+	Context context{ symbol_table, interner };
+	Value value{};
+	for (const Closure* statement : statements) {
+		value = statement->function(*statement, context);
+	}
+	if (!returns_value) {
+		return std::nullopt;
+	}
+	return value;
+}
@@ -0,0 +1,50 @@
+#ifndef CLOSURES_HPP
+#define CLOSURES_HPP
+
+#include "globals.hpp"
+#include "flat_tree.hpp"
+#include "interner.hpp"
+#include "symbol_table.hpp"
+#include "arena.hpp"
+
+#include <vector>
+#include <deque>
+
+// a tree compiled into a tree of closures: each node is a function already chosen for its operator, bound to its children.
+// running it is a chain of indirect calls, with no operator dispatch and no tokens to inspect.
+// like Bytecode, it views into nothing, and names are compiled to the symbol ids of the interner given to Compile.
+class ClosureCode {
+public:
+	ClosureCode() = default;
+	// identifiers lexed without an interner are interned on compiling
+	static ClosureCode Compile(const FlatTree& tree, Interner& interner);
+	// returns the value of the last statement, if it is an expression.
+	// symbol_table must have a slot for every name in interner.
+	std::optional<Value> Run(SymbolTable& symbol_table, const Interner& interner) const;
+private:
+	struct Context {
+		SymbolTable& symbol_table;
+		const Interner& interner;
+	};
+	// a chain ("a + b - c", or "a < b < c") is a closure of its first operand, followed by a list of links, each holding an operator
+	// and the operand to its right.
+	struct Closure {
+		Value (*function)(const Closure& self, Context& context);
+		const Closure* left = nullptr;	// or the only child, or the operand of a link
+		const Closure* right = nullptr;	// or the first or next link of a chain
+		bool (*compare)(const Value& left, const Value& right) = nullptr;	// of a link of a chained comparison
+		Value (*apply)(const Value& left, const Closure& link, Context& context) = nullptr;	// of a link of a chain of other operators
+		const Value* constant = nullptr;	// of a constant (or the constant right operand of an arithmetic operator)
+		SymbolId symbol = no_symbol;	// read or assigned
+	};
+
+	Arena arena{ 512 };	// owns the closures. most code is a line or two, and there is code for every block of a file
+	// the values of constants, which the arena could not destroy. (a deque, so that closures can point to them.)
+	std::deque<Value> constants{};
+	std::vector<const Closure*> statements{};
+	bool returns_value = false;	// whether the last statement is an expression
+
+	class Compiler;
+};
+
+#endif
@@ -18,10 +18,10 @@
 //}
 
 std::optional<Command> CommandHandler::GetCommand(const std::vector<Token>& token_line) noexcept {
-	if (token_line.empty() || !std::holds_alternative<std::string>(token_line.front().value)) {
+	if (token_line.empty() || !std::holds_alternative<std::string_view>(token_line.front().value)) {
 		return {};
 	}
-	return StringToCommand(std::get<std::string>(token_line.front().value));	// may or may not be valid
+	return StringToCommand(std::get<std::string_view>(token_line.front().value));	// may or may not be valid
 }
 
 std::optional<Command> CommandHandler::StringToCommand(std::string_view command) {
@@ -133,6 +133,7 @@ void CommandHandler::Help(std::string_view initial_argument) {
 				std::cout << "Displays the contents of the imported .py file." << std::endl;
 				std::cout << "\tshow(tokens)\tDisplays the tokens generated from lexical analysis." << std::endl;
 				std::cout << "\tshow(variables)\t Displays the symbol table containing stored variables." << std::endl;
+				std::cout << "\tshow(bytecode)\t Displays the bytecode compiled from the file, or from the last line run." << std::endl;
 				break;
 			case Command::Clear:
 				std::cout << "Clears any file data from any prior \"read\" command." << std::endl;
@@ -147,11 +148,15 @@ void CommandHandler::Help(std::string_view initial_argument) {
 
 // const std::string& instead of std::string_view because file opening does not support std::string_view ._.
 void CommandHandler::Read(const std::string& filename) {
-	FileExecution new_file_execution(filename);
-	curr_execution = new_file_execution;
+	// reading again (usually the same file, after an edit) only re-lexes and re-parses what changed
+	if (const FileExecution* previous = std::get_if<FileExecution>(&curr_execution)) {
+		curr_execution = FileExecution(filename, *previous);
+		return;
+	}
+	curr_execution = FileExecution(filename);
 }
 
-void CommandHandler::Show(std::string_view argument) const {
+void CommandHandler::Show(std::string_view argument) {
 	if (argument == "") {
 		if (!std::holds_alternative<FileExecution>(curr_execution)) {
 			throw std::invalid_argument("No file has been opened!");
@@ -163,14 +168,16 @@ void CommandHandler::Show(std::string_view argument) const {
 		if (!std::holds_alternative<FileExecution>(curr_execution)) {
 			throw std::invalid_argument("No file has been opened!");
 		}
-		const auto& file_tokens = std::get<FileExecution>(curr_execution).GetFileTokens();
+		const std::vector<Token> file_tokens = std::get<FileExecution>(curr_execution).GetFileTokens();
 		PrintTokenLine(file_tokens);
 	}
 	else if (argument == "variables") {
 		// display symbol table contents
-		const std::unordered_map<std::string, ValueType>* symbol_table{};
-		std::visit([&symbol_table](const auto& v) {symbol_table = &v.GetSymbolTable(); }, curr_execution);
-		PrintSymbolTable(symbol_table);
+		std::visit([](const auto& v) {PrintSymbolTable(v.GetSymbolTable(), v.GetInterner()); }, curr_execution);
+	}
+	else if (argument == "bytecode") {
+		// the file's bytecode (compiling it if it has not been run), or that of the last line run
+		std::visit([](auto& v) {std::cout << v.Disassemble(); }, curr_execution);
 	}
 	else {
 		throw std::invalid_argument("invalid argument");
@@ -184,6 +191,17 @@ void CommandHandler::Run() {
 	std::get<FileExecution>(curr_execution).Run();
 }
 
+std::optional<Value> CommandHandler::RunLine(std::string_view line) {
+	// running code from the interface discards any file that was read
+	if (!std::holds_alternative<InterfaceExecution>(curr_execution)) {
+		ClearData();
+	}
+	InterfaceExecution& interface_execution = std::get<InterfaceExecution>(curr_execution);
+	// identifiers must be interned with the execution's interner, so the line is lexed again (the caller lexed it to look for a command)
+	const std::vector<Token> tokens = Lexer::GenerateTokens(line, &interface_execution.GetInterner());
+	return interface_execution.Run(tokens);
+}
+
 void CommandHandler::ClearData() {
 	curr_execution = InterfaceExecution{};
 }
@@ -203,10 +221,8 @@ void CommandHandler::PrintTokenLine(const std::vector<Token>& token_line) {
 	}
 }
 
-void CommandHandler::PrintSymbolTable(const std::unordered_map<std::string, ValueType>* symbol_table) {
-	for (const auto& pair : *symbol_table) {
-		std::cout << pair.first << " = ";
-		std::visit([](const auto& v) {std::cout << v; }, pair.second);
-		std::cout << std::endl;
+void CommandHandler::PrintSymbolTable(const SymbolTable& symbol_table, const Interner& interner) {
+	for (const SymbolId slot : symbol_table.GetAssigned()) {
+		std::cout << interner.GetName(slot) << " = " << symbol_table.At(slot) << std::endl;
 	}
 }
\ No newline at end of file
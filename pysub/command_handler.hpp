@@ -32,13 +32,15 @@ public:
 	void Execute(const Command command, std::string_view argument = "");
 	static void Help(std::string_view argument = "");
 	void Read(const std::string& filename);
-	void Show(std::string_view argument) const;
+	void Show(std::string_view argument);
 	void Run();
+	// runs a line typed into the interface, returning its value (if it has one) to be echoed
+	std::optional<Value> RunLine(std::string_view line);
 	void ClearData();
 private:
 	std::variant<InterfaceExecution, FileExecution> curr_execution{};	// InterfaceExecution is the default
 	static void PrintTokenLine(const std::vector<Token>& token_line);
-	static void PrintSymbolTable(const std::unordered_map<std::string, ValueType>* symbol_table);
+	static void PrintSymbolTable(const SymbolTable& symbol_table, const Interner& interner);
 };
 
 constexpr auto CommandHandler::GetCommandList() {
@@ -0,0 +1,33 @@
+#ifndef COPY_ON_WRITE_HPP
+#define COPY_ON_WRITE_HPP
+
+#include <memory>
+#include <utility>
+
+// a value shared by its copies until one of them changes it: copying is O(1), and the first change made through a copy
+// that still shares the value copies it, so the others never see the change.
+// (as with std::shared_ptr, copies may be used from different threads, but one copy may not be used from two at once.)
+template <typename T>
+class CopyOnWrite {
+public:
+	CopyOnWrite() : value(std::make_shared<T>()) {}
+	explicit CopyOnWrite(T _value) : value(std::make_shared<T>(std::move(_value))) {}
+
+	const T& Get() const noexcept {
+		return *value;
+	}
+	// copies the value first if it is shared. changes through the reference must be made before this is next copied.
+	T& GetMutable() {
+		if (IsShared()) {
+			value = std::make_shared<T>(std::as_const(*value));
+		}
+		return *value;
+	}
+	bool IsShared() const noexcept {
+		return value.use_count() > 1;
+	}
+private:
+	std::shared_ptr<T> value;
+};
+
+#endif
@@ -1,73 +1,640 @@
 #include "execution.hpp"
 #include "lexer.hpp"
+#include "arithmetic.hpp"
+#include "optimizer.hpp"
 
+#include <limits>
 #include <fstream>
-#include <sstream>
-#include <iostream>	// TEMP! REMOVE after RunCode is defined
+#include <functional>
+#include <iterator>
 #include <cassert>
 
+/* Virtual machine */
+
+// instructions are dispatched by computed goto where the compiler supports it (gcc and clang):
+// each instruction jumps straight to the next one's handler, which branch predictors handle far better than one shared switch.
+// define PYSUB_NO_COMPUTED_GOTO to use the switch anyway.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(PYSUB_NO_COMPUTED_GOTO)
+#define PYSUB_COMPUTED_GOTO
+#endif
+
+#ifdef PYSUB_COMPUTED_GOTO
+#define VM_TARGET(op_code) target_##op_code:
+#define VM_DISPATCH() instruction = ip++; goto *dispatch_table[static_cast<uint8_t>(instruction->op_code)]
+#define VM_LOOP() VM_DISPATCH();
+#else
+#define VM_TARGET(op_code) case OpCode::op_code:
+#define VM_DISPATCH() continue
+#define VM_LOOP() for (;;) switch (instruction = ip++, instruction->op_code)
+#endif
+
+/* ExecutionSnapshot functions */
+
+Backend ExecutionSnapshot::GetBackend() const {
+	return backend;
+}
+
+const SymbolTable& ExecutionSnapshot::GetSymbolTable() const {
+	return symbol_table.Get();
+}
+
+const Interner& ExecutionSnapshot::GetInterner() const {
+	return interner.Get();
+}
+
 /* Execution functions */
 
-void Execution::RunCode(const std::vector<Token>& tokens) {
-	// do stuff with interpreter
-	size_t i = tokens.size();
-	std::cout << i << std::endl;	// temp line of code to avoid warnings
+Execution::Execution(CopyOnWrite<Interner> _interner, Backend _backend) : interner(std::move(_interner)), backend(_backend) {
+	symbol_table.GetMutable().Grow(interner.Get().Size());
+}
+
+Execution::Execution(const ExecutionSnapshot& snapshot)
+	: interner(snapshot.interner), backend(snapshot.backend), symbol_table(snapshot.symbol_table) {}
+
+CompiledCode Execution::Compile(const AST& tree, Interner& code_interner, Backend code_backend) {
+	const FlatTree flat_tree(tree);
+	switch (code_backend) {
+	case Backend::Bytecode:
+		return Bytecode::Compile(flat_tree, code_interner);
+	case Backend::Closures:
+		return ClosureCode::Compile(flat_tree, code_interner);
+	}
+	throw std::invalid_argument("invalid backend");
+}
+
+std::optional<Value> Execution::RunCode(const AST& tree) {
+	return RunCompiled(Compile(tree, interner.GetMutable(), backend));
+}
+
+std::optional<Value> Execution::RunCompiled(const CompiledCode& code) {
+	SymbolTable& variables = symbol_table.GetMutable();
+	variables.Grow(interner.Get().Size());
+	if (const Bytecode* bytecode = std::get_if<Bytecode>(&code)) {
+		return RunBytecode(*bytecode);
+	}
+	return std::get<ClosureCode>(code).Run(variables, interner.Get());
+}
+
+std::optional<Value> Execution::RunBytecode(const Bytecode& code) {
+	// every value is an int (the grammar has no other literals). like python's True and False, booleans are 1 and 0.
+	// the stack is sized by the compiler, so pushes are never checked. popped values are left in place until they are overwritten.
+	if (stack.size() < code.GetMaxStackSize()) {
+		stack.resize(code.GetMaxStackSize());
+	}
+	const Instruction* ip = code.GetInstructions().data();
+	const Instruction* instruction = nullptr;
+	Value* top = stack.data();	// one past the top value
+	SymbolTable& variables = symbol_table.GetMutable();	// unshared once, rather than on every store
+
+#ifdef PYSUB_COMPUTED_GOTO
+	// in the order of OpCode
+	static constexpr void* dispatch_table[] = {
+		&&target_PushInteger, &&target_PushConstant, &&target_LoadName, &&target_StoreName, &&target_Pop, &&target_Duplicate, &&target_Swap,
+		&&target_RotateThree, &&target_Add, &&target_Subtract, &&target_Multiply, &&target_Divide, &&target_Modulo, &&target_Negate, &&target_Not,
+		&&target_Equal, &&target_NotEqual, &&target_Less, &&target_LessEqual, &&target_Greater, &&target_GreaterEqual,
+		&&target_Jump, &&target_JumpIfFalseOrPop, &&target_JumpIfTrueOrPop, &&target_Return, &&target_ReturnNone
+	};
+	static_assert(std::size(dispatch_table) == op_code_count);
+#endif
+
+	VM_LOOP() {
+	VM_TARGET(PushInteger)
+		top->AssignInt(static_cast<int32_t>(instruction->operand));
+		++top;
+		VM_DISPATCH();
+	VM_TARGET(PushConstant)
+		*top++ = code.GetConstants()[instruction->operand];
+		VM_DISPATCH();
+	VM_TARGET(LoadName) {
+		const Value* value = variables.Find(instruction->operand);
+		if (!value) {
+			throw std::runtime_error("name '" + std::string{ interner.Get().GetName(instruction->operand) } + "' is not defined");
+		}
+		if (!value->IsInt()) {
+			throw std::runtime_error("unsupported operand type: str");
+		}
+		*top++ = *value;
+		VM_DISPATCH();
+	}
+	VM_TARGET(StoreName)
+		variables.Assign(instruction->operand, *--top);
+		VM_DISPATCH();
+	VM_TARGET(Pop)
+		--top;
+		VM_DISPATCH();
+	VM_TARGET(Duplicate)
+		*top = top[-1];
+		++top;
+		VM_DISPATCH();
+	VM_TARGET(Swap)
+		std::swap(top[-1], top[-2]);
+		VM_DISPATCH();
+	VM_TARGET(RotateThree) {
+		Value value = std::move(top[-1]);
+		top[-1] = std::move(top[-2]);
+		top[-2] = std::move(top[-3]);
+		top[-3] = std::move(value);
+		VM_DISPATCH();
+	}
+	VM_TARGET(Add)
+		--top;
+		Arithmetic::AddInPlace(top[-1], top[0]);
+		VM_DISPATCH();
+	VM_TARGET(Subtract)
+		--top;
+		Arithmetic::SubtractInPlace(top[-1], top[0]);
+		VM_DISPATCH();
+	VM_TARGET(Multiply)
+		--top;
+		Arithmetic::MultiplyInPlace(top[-1], top[0]);
+		VM_DISPATCH();
+	VM_TARGET(Divide)
+		--top;
+		Arithmetic::DivideInPlace(top[-1], top[0]);
+		VM_DISPATCH();
+	VM_TARGET(Modulo)
+		--top;
+		Arithmetic::ModuloInPlace(top[-1], top[0]);
+		VM_DISPATCH();
+	VM_TARGET(Negate)
+		Arithmetic::NegateInPlace(top[-1]);
+		VM_DISPATCH();
+	VM_TARGET(Not)
+		top[-1].AssignInt(Arithmetic::IsZero(top[-1]));
+		VM_DISPATCH();
+	VM_TARGET(Equal)
+		--top;
+		Arithmetic::CompareInPlace(top[-1], top[0], std::equal_to<>{});
+		VM_DISPATCH();
+	VM_TARGET(NotEqual)
+		--top;
+		Arithmetic::CompareInPlace(top[-1], top[0], std::not_equal_to<>{});
+		VM_DISPATCH();
+	VM_TARGET(Less)
+		--top;
+		Arithmetic::CompareInPlace(top[-1], top[0], std::less<>{});
+		VM_DISPATCH();
+	VM_TARGET(LessEqual)
+		--top;
+		Arithmetic::CompareInPlace(top[-1], top[0], std::less_equal<>{});
+		VM_DISPATCH();
+	VM_TARGET(Greater)
+		--top;
+		Arithmetic::CompareInPlace(top[-1], top[0], std::greater<>{});
+		VM_DISPATCH();
+	VM_TARGET(GreaterEqual)
+		--top;
+		Arithmetic::CompareInPlace(top[-1], top[0], std::greater_equal<>{});
+		VM_DISPATCH();
+	VM_TARGET(Jump)
+		ip = code.GetInstructions().data() + instruction->operand;
+		VM_DISPATCH();
+	VM_TARGET(JumpIfFalseOrPop)
+		if (Arithmetic::IsZero(top[-1])) {
+			ip = code.GetInstructions().data() + instruction->operand;
+		}
+		else {
+			--top;
+		}
+		VM_DISPATCH();
+	VM_TARGET(JumpIfTrueOrPop)
+		if (!Arithmetic::IsZero(top[-1])) {
+			ip = code.GetInstructions().data() + instruction->operand;
+		}
+		else {
+			--top;
+		}
+		VM_DISPATCH();
+	VM_TARGET(Return)
+		return top[-1];
+	VM_TARGET(ReturnNone)
+		return std::nullopt;
+	}
+}
+
+#undef VM_TARGET
+#undef VM_DISPATCH
+#undef VM_LOOP
+
+Backend Execution::GetBackend() const {
+	return backend;
 }
 
-const std::unordered_map<std::string, ValueType>& Execution::GetSymbolTable() const {
-	return symbol_table;
+const SymbolTable& Execution::GetSymbolTable() const {
+	return symbol_table.Get();
+}
+
+Interner& Execution::GetInterner() {
+	return interner.GetMutable();
+}
+const Interner& Execution::GetInterner() const {
+	return interner.Get();
+}
+
+ExecutionSnapshot Execution::Snapshot() const {
+	ExecutionSnapshot snapshot{};
+	snapshot.backend = backend;
+	snapshot.interner = interner;
+	snapshot.symbol_table = symbol_table;
+	return snapshot;
+}
+
+void Execution::Restore(const ExecutionSnapshot& snapshot) {
+	backend = snapshot.backend;
+	interner = snapshot.interner;
+	symbol_table = snapshot.symbol_table;
 }
 
 /* FileExecution functions */
 
-FileExecution::FileExecution(const std::string& filename) {
-	file_string = ReadEntireFile(filename);
+FileExecution::FileExecution(const std::string& filename, Backend _backend) : backend(_backend), cache_path(GetCachePath(filename)) {
+	// copied out of the mapping at once: a file edited in place changes under its mapping (or faults, if it shrinks)
+	source = std::make_shared<const std::string>(SourceBuffer(filename).GetView());
+	if (backend == Backend::Bytecode && TryLoadCache()) {
+		return;
+	}
 
+	// lex up front so that errors are reported on read
 	try {
-		file_tokens = Lexer::GenerateTokens(file_string);
+		tokens = std::make_shared<const TokenBuffer>(TokenBuffer::Lex(*source, &file_interner.GetMutable()));
 	}
 	catch (const std::exception& ex) {
 		throw Utilities::AddContext("lexer", ex);
 	}
+
+	blocks = SplitBlocks(*source);
+	FindBlockTokens();
+}
+
+FileExecution::FileExecution(const std::string& filename, const FileExecution& previous)
+	: backend(previous.backend), file_interner(previous.file_interner), cache_path(GetCachePath(filename)) {
+	// the interner is carried over so that reused tokens and trees keep their symbol ids
+	source = std::make_shared<const std::string>(SourceBuffer(filename).GetView());
+	const std::string_view text = *source;
+	if (text.size() > std::numeric_limits<uint32_t>::max()) {
+		throw Utilities::AddContext("lexer", std::length_error("source is too large to index with 32-bit offsets"));
+	}
+
+	blocks = SplitBlocks(text);
+
+	// match each block to an identical one from the previous read, if any.
+	// unchanged blocks at the start and end are matched in order; only those in between are looked up by hash (to find moved blocks).
+	// hashes only find candidates: a match must have the same text as the previous block was lexed from, which the previous read
+	// holds a copy of (the file itself has usually been edited in place since).
+	const std::string_view previous_text = *previous.source;
+	auto IsSame = [text, previous_text](const Block& block, const Block& previous_block) {
+		return block.hash == previous_block.hash && block.size == previous_block.size
+			&& text.substr(block.offset, block.size) == previous_text.substr(previous_block.offset, previous_block.size);
+	};
+	const std::vector<Block>& previous_blocks = previous.blocks;
+	size_t prefix = 0;
+	while (prefix < blocks.size() && prefix < previous_blocks.size() && IsSame(blocks[prefix], previous_blocks[prefix])) {
+		++prefix;
+	}
+	size_t suffix = 0;
+	while (suffix < blocks.size() - prefix && suffix < previous_blocks.size() - prefix
+		&& IsSame(blocks[blocks.size() - 1 - suffix], previous_blocks[previous_blocks.size() - 1 - suffix])) {
+		++suffix;
+	}
+	std::unordered_map<size_t, size_t> previous_middle{};
+	for (size_t i = prefix; i < previous_blocks.size() - suffix; ++i) {
+		previous_middle.emplace(previous_blocks[i].hash, i);
+	}
+	constexpr size_t no_match = std::numeric_limits<size_t>::max();
+	std::vector<size_t> matches(blocks.size(), no_match);
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		if (i < prefix) {
+			matches[i] = i;
+		}
+		else if (i >= blocks.size() - suffix) {
+			matches[i] = i - blocks.size() + previous_blocks.size();
+		}
+		else if (auto iter = previous_middle.find(blocks[i].hash); iter != std::end(previous_middle) && IsSame(blocks[i], previous_blocks[iter->second])) {
+			matches[i] = iter->second;
+		}
+	}
+
+	// reused tokens hold no text (only offsets, lengths, and symbols), so they are moved onto the new source as they are
+	auto new_tokens = std::make_shared<TokenBuffer>(text);
+	new_tokens->Reserve(previous.tokens->Size(), previous.tokens->GetLineCount());	// edits are usually small
+	int indent_level = 0;
+	for (size_t i = 0; i < blocks.size();) {
+		if (matches[i] == no_match) {
+			Lexer lexer(text.substr(blocks[i].offset, blocks[i].size), &file_interner.GetMutable());
+			try {
+				TokenBuffer block_tokens(lexer);
+				indent_level = new_tokens->AppendBlock(block_tokens, 0, block_tokens.Size(), 0, blocks[i].offset, indent_level);
+			}
+			catch (const std::exception& ex) {
+				SourceLocation location = lexer.GetTokenLocation();
+				location.line += static_cast<uint32_t>(new_tokens->GetLineCount()) - 1;
+				throw Utilities::AddContext("lexer", Utilities::AddContext(Utilities::LocationToString(location), ex));
+			}
+			++i;
+			continue;
+		}
+		// blocks that were also consecutive in the previous read are copied together
+		size_t run_end = i + 1;
+		while (run_end < blocks.size() && matches[run_end] == matches[run_end - 1] + 1) {
+			++run_end;
+		}
+		const Block& first_previous = previous_blocks[matches[i]];
+		const Block& last_previous = previous_blocks[matches[run_end - 1]];
+		indent_level = new_tokens->AppendBlock(*previous.tokens, first_previous.first_token, last_previous.last_token,
+			first_previous.offset, blocks[i].offset, indent_level);
+		for (; i < run_end; ++i) {
+			blocks[i].parsed = previous_blocks[matches[i]].parsed;
+		}
+	}
+	tokens = std::move(new_tokens);
+	FindBlockTokens();
+}
+
+void FileExecution::FindBlockTokens() {
+	// a block's tokens begin with any dedents at its start, which are placed at the start of its first line
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		blocks[i].first_token = tokens->FindToken(blocks[i].offset, i > 0 ? blocks[i - 1].first_token : 0);
+		if (i > 0) {
+			blocks[i - 1].last_token = blocks[i].first_token;
+		}
+	}
+	if (!blocks.empty()) {
+		blocks.back().last_token = tokens->Size();
+	}
+}
+
+void FileExecution::ParseBlocks() {
+	bool is_compiled = false;
+	for (Block& block : blocks) {
+		if (block.parsed) {
+			continue;
+		}
+		auto new_parsed = std::make_shared<ParsedBlock>();
+		new_parsed->text = source->substr(block.offset, block.size);
+		// the block's tokens, moved onto the copy of its text
+		size_t leading_dedents = 0;
+		while (block.first_token + leading_dedents < block.last_token && tokens->GetCategory(block.first_token + leading_dedents) == Category::Dedent) {
+			++leading_dedents;
+		}
+		TokenBuffer block_tokens(new_parsed->text);
+		block_tokens.AppendBlock(*tokens, block.first_token, block.last_token, block.offset, 0, static_cast<int>(leading_dedents));
+
+		Parser parser(block_tokens);
+		try {
+			new_parsed->tree = parser.BuildTree();
+		}
+		catch (const std::exception& ex) {
+			assert(parser.GetLocation());
+			SourceLocation location = *parser.GetLocation();
+			location.line += tokens->GetLocation(block.first_token).line - 1;
+			throw Utilities::AddContext("parser", Utilities::AddContext(Utilities::LocationToString(location), ex));
+		}
+		try {
+			Optimizer(*new_parsed->tree).Optimize();
+			new_parsed->code = Execution::Compile(*new_parsed->tree, file_interner.GetMutable(), backend);
+		}
+		catch (const std::exception& ex) {
+			const SourceLocation location = tokens->GetLocation(block.first_token);
+			throw Utilities::AddContext("compiler", Utilities::AddContext(Utilities::LocationToString(location), ex));
+		}
+		block.parsed = std::move(new_parsed);
+		is_compiled = true;
+	}
+	if (is_compiled && backend == Backend::Bytecode) {
+		WriteCache();
+	}
 }
 
 void FileExecution::Run() {
-	Execution new_execution;
-	new_execution.RunCode(file_tokens);
+	// every block is parsed before any is run, so a syntax error anywhere stops the whole file
+	ParseBlocks();
+
+	Execution new_execution(file_interner, backend);	// shares the interner, as running never adds names
+	try {
+		for (const Block& block : blocks) {
+			new_execution.RunCompiled(block.parsed->code);
+		}
+	}
+	catch (const std::exception& ex) {
+		throw Utilities::AddContext("runtime error", ex);
+	}
 	// we want to reset the context every time the file is run (as opposed to InterfaceExecution, whose context is persistent).
-	execution = new_execution;
+	execution = std::move(new_execution);
 }
 
-const std::string& FileExecution::GetFileString() const {
-	return file_string;
+std::string FileExecution::Disassemble() {
+	if (backend != Backend::Bytecode) {
+		throw std::invalid_argument("only bytecode can be disassembled");
+	}
+	ParseBlocks();
+	std::string disassembly{};
+	for (const Block& block : blocks) {
+		const Bytecode& code = std::get<Bytecode>(block.parsed->code);
+		if (code.GetInstructions().size() <= 1) {
+			continue;	// nothing but ReturnNone (e.g. a comment)
+		}
+		disassembly += "line " + std::to_string(tokens->GetLocation(block.first_token).line) + ":\n";
+		disassembly += code.Disassemble(file_interner.Get());
+	}
+	return disassembly;
 }
-const std::vector<Token>& FileExecution::GetFileTokens() const {
-	return file_tokens;
+
+std::vector<FileExecution::Block> FileExecution::SplitBlocks(std::string_view text) {
+	// a block starts at every line that does not start with whitespace
+	std::vector<Block> new_blocks{};
+	size_t block_start = 0;
+	size_t line_start = 0;
+	while (line_start < text.size()) {
+		const size_t line_end = text.find('\n', line_start);
+		const size_t next_line_start = line_end == std::string_view::npos ? text.size() : line_end + 1;
+		if (next_line_start == text.size() || Utilities::GetCharClass(text[next_line_start]) != CharClass::Whitespace) {
+			const std::string_view block_text = text.substr(block_start, next_line_start - block_start);
+			new_blocks.push_back({ .offset = static_cast<uint32_t>(block_start), .size = static_cast<uint32_t>(block_text.size()),
+				.hash = std::hash<std::string_view>{}(block_text) });
+			block_start = next_line_start;
+		}
+		line_start = next_line_start;
+	}
+	return new_blocks;
 }
 
-const std::unordered_map<std::string, ValueType>& FileExecution::GetSymbolTable() const {
-	return execution.GetSymbolTable();
+std::filesystem::path FileExecution::GetCachePath(const std::filesystem::path& file_path) {
+	std::filesystem::path cache_name = file_path.filename();
+	cache_name += ".pysubc";
+	return file_path.parent_path() / "__pysubcache__" / cache_name;
+}
+
+bool FileExecution::TryLoadCache() {
+	// the cache holds the interner's names (in id order), the file's tokens, and each block's extent and bytecode.
+	// a stale cache is caught by its header, which keys it by the build that wrote it and a hash of the source it was compiled from,
+	// and a damaged one by checks enough that its code cannot run out of bounds.
+	const std::string_view text = *source;
+	if (text.size() > std::numeric_limits<uint32_t>::max()) {
+		return false;
+	}
+	Interner cached_interner{};
+	std::shared_ptr<const TokenBuffer> cached_tokens{};
+	std::vector<Block> cached_blocks{};
+	try {
+		std::error_code error{};
+		if (!std::filesystem::is_regular_file(cache_path, error)) {
+			return false;
+		}
+		const SourceBuffer cache(cache_path, false);	// mapped, and copied out of before it is unmapped
+		BinaryReader reader(cache.GetView());
+		if (reader.Read<uint32_t>() != cache_magic || reader.Read<uint32_t>() != cache_version || reader.ReadString() != interpreter_build
+			|| reader.Read<ContentHash>() != ContentHash::Of(text) || reader.Read<uint64_t>() != text.size()) {
+			return false;
+		}
+		const uint64_t symbol_count = reader.Read<uint64_t>();
+		for (uint64_t id = 0; id < symbol_count; ++id) {
+			if (cached_interner.Intern(reader.ReadString()) != id) {
+				return false;	// a repeated name
+			}
+		}
+		cached_tokens = std::make_shared<const TokenBuffer>(TokenBuffer::Deserialize(reader, text, cached_interner.Size()));
+
+		// blocks follow each other, so each is stored as its size, its number of tokens, and its hash
+		const uint64_t block_count = reader.Read<uint64_t>();
+		if (block_count > reader.GetRemaining()) {
+			return false;
+		}
+		uint64_t offset = 0;
+		uint64_t first_token = 0;
+		for (uint64_t i = 0; i < block_count; ++i) {
+			Block block{};
+			const uint32_t size = reader.Read<uint32_t>();
+			const uint32_t token_count = reader.Read<uint32_t>();
+			block.hash = static_cast<size_t>(reader.Read<uint64_t>());
+			if (offset + size > text.size() || first_token + token_count > cached_tokens->Size()) {
+				return false;
+			}
+			block.offset = static_cast<uint32_t>(offset);
+			block.size = size;
+			block.first_token = static_cast<size_t>(first_token);
+			block.last_token = static_cast<size_t>(first_token + token_count);
+			auto cached_parsed = std::make_shared<ParsedBlock>();
+			cached_parsed->code = Bytecode::Deserialize(reader, cached_interner.Size());
+			block.parsed = std::move(cached_parsed);
+			cached_blocks.push_back(std::move(block));
+			offset += size;
+			first_token += token_count;
+		}
+		if (offset != text.size() || (!cached_blocks.empty() && first_token != cached_tokens->Size()) || !reader.IsAtEnd()) {
+			return false;
+		}
+	}
+	catch (const std::exception&) {
+		return false;
+	}
+	file_interner = CopyOnWrite<Interner>(std::move(cached_interner));
+	tokens = std::move(cached_tokens);
+	blocks = std::move(cached_blocks);
+	is_cached = true;
+	return true;
 }
 
-std::string FileExecution::ReadEntireFile(std::filesystem::path file_path) {
-	std::ifstream file_stream(file_path);
-	if (file_stream.fail()) {
-		throw std::runtime_error("error opening file");
+void FileExecution::WriteCache() const {
+	BinaryWriter writer{};
+	const std::string_view text = *source;
+	writer.Write(cache_magic);
+	writer.Write(cache_version);
+	writer.WriteString(interpreter_build);
+	writer.Write(ContentHash::Of(text));
+	writer.Write(static_cast<uint64_t>(text.size()));
+	const Interner& interner = file_interner.Get();
+	writer.Write(static_cast<uint64_t>(interner.Size()));
+	for (SymbolId id = 0; id < interner.Size(); ++id) {
+		writer.WriteString(interner.GetName(id));
+	}
+	tokens->Serialize(writer);
+	writer.Write(static_cast<uint64_t>(blocks.size()));
+	for (const Block& block : blocks) {
+		writer.Write(block.size);
+		writer.Write(static_cast<uint32_t>(block.last_token - block.first_token));
+		writer.Write(static_cast<uint64_t>(block.hash));
+		std::get<Bytecode>(block.parsed->code).Serialize(writer);
+	}
+
+	// written to a temporary file that is then renamed over the cache, so that a reader never sees part of one
+	std::error_code error{};
+	std::filesystem::create_directories(cache_path.parent_path(), error);
+	if (error) {
+		return;
+	}
+	std::filesystem::path temporary_path = cache_path;
+	temporary_path += ".tmp";
+	{
+		std::ofstream file_stream(temporary_path, std::ios::out | std::ios::binary | std::ios::trunc);
+		file_stream.write(writer.GetBytes().data(), static_cast<std::streamsize>(writer.GetBytes().size()));
+		if (!file_stream) {
+			file_stream.close();
+			std::filesystem::remove(temporary_path, error);
+			return;
+		}
+	}
+	std::filesystem::rename(temporary_path, cache_path, error);
+	if (error) {
+		std::filesystem::remove(temporary_path, error);
 	}
-	const auto file_size = std::filesystem::file_size(file_path);
-	std::string output(file_size, '\0');
-	file_stream.read(output.data(), file_size);
-	auto last = output.find_first_of('\0');	// file_size may exceed size of its contents, so we shrink
-	output.resize(last);
-	return output;
+}
+
+std::string_view FileExecution::GetFileString() const {
+	return *source;
+}
+std::vector<Token> FileExecution::GetFileTokens() const {
+	std::vector<Token> file_tokens{};
+	file_tokens.reserve(tokens->Size());
+	for (size_t i = 0; i < tokens->Size(); ++i) {
+		file_tokens.push_back(tokens->GetToken(i));
+	}
+	return file_tokens;
+}
+
+const SymbolTable& FileExecution::GetSymbolTable() const {
+	return execution.GetSymbolTable();
+}
+const Interner& FileExecution::GetInterner() const {
+	return execution.GetInterner();
+}
+ExecutionSnapshot FileExecution::Snapshot() const {
+	return execution.Snapshot();
+}
+bool FileExecution::IsCached() const {
+	return is_cached;
 }
 
 /* InterfaceExecution functions */
 
-void InterfaceExecution::Run(const std::vector<Token>& tokens) {
-	execution.RunCode(tokens);
+std::optional<Value> InterfaceExecution::Run(const std::vector<Token>& tokens) {
+	Parser parser(tokens);
+	std::unique_ptr<AST> tree = parser.BuildTree();
+	Optimizer(*tree).Optimize();
+	last_code = Execution::Compile(*tree, execution.GetInterner(), execution.GetBackend());
+	return execution.RunCompiled(last_code);
+}
+
+std::string InterfaceExecution::Disassemble() const {
+	const Bytecode* code = std::get_if<Bytecode>(&last_code);
+	if (!code) {
+		throw std::invalid_argument("only bytecode can be disassembled");
+	}
+	return code->Disassemble(execution.GetInterner());
 }
 
-const std::unordered_map<std::string, ValueType>& InterfaceExecution::GetSymbolTable() const {
+const SymbolTable& InterfaceExecution::GetSymbolTable() const {
 	return execution.GetSymbolTable();
+}
+Interner& InterfaceExecution::GetInterner() {
+	return execution.GetInterner();
+}
+const Interner& InterfaceExecution::GetInterner() const {
+	return execution.GetInterner();
+}
+ExecutionSnapshot InterfaceExecution::Snapshot() const {
+	return execution.Snapshot();
+}
+void InterfaceExecution::Restore(const ExecutionSnapshot& snapshot) {
+	execution.Restore(snapshot);
+	last_code = {};	// compiled with the interner being replaced
 }
\ No newline at end of file
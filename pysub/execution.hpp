@@ -2,40 +2,173 @@
 #define EXECUTION_HPP
 
 #include "globals.hpp"
+#include "parser.hpp"
+#include "source.hpp"
+#include "interner.hpp"
+#include "symbol_table.hpp"
+#include "bytecode.hpp"
+#include "closures.hpp"
+#include "copy_on_write.hpp"
 
 #include <unordered_map>
 #include <filesystem>
+#include <memory>
 
 // we avoid using inheritance by using std::variant and composition because I don't like heap allocation.
 
+// what trees are compiled to, and run as.
+// bytecode is run by a virtual machine, and is the default; closures skip the dispatch loop, but cannot be disassembled.
+// the backends run the same programs, except that closures recurse to run nested expressions: an expression nested more than
+// 1000 levels deep (as in "a + (b + (c + ...)))", but not a long chain like "a + b + c + ...") is rejected on compiling,
+// with "maximum recursion depth exceeded", where bytecode runs it.
+enum class Backend {
+	Bytecode,
+	Closures
+};
+using CompiledCode = std::variant<Bytecode, ClosureCode>;
+
+// the state of an execution (its backend, interner, and variables) at one point. taking one is O(1): the state is shared,
+// and is only copied when an execution sharing it next changes it. so an execution set up once can be snapshotted,
+// and each of many runs can start from the snapshot, instead of running the setup code again.
+class ExecutionSnapshot {
+public:
+	Backend GetBackend() const;
+	const SymbolTable& GetSymbolTable() const;
+	const Interner& GetInterner() const;
+private:
+	friend class Execution;
+
+	Backend backend = Backend::Bytecode;
+	CopyOnWrite<Interner> interner{};
+	CopyOnWrite<SymbolTable> symbol_table{};
+};
+
+// move-only, as copying would copy every variable; share state with Snapshot instead.
 class Execution {
 public:
-	void RunCode(const std::vector<Token>& tokens);
-	const std::unordered_map<std::string, ValueType>& GetSymbolTable() const;
+	Execution() = default;
+	explicit Execution(Backend _backend) : backend(_backend) {}
+	// for code already lexed with (a copy of) the interner, which is shared until either changes it
+	explicit Execution(CopyOnWrite<Interner> _interner, Backend _backend = Backend::Bytecode);
+	// continues from where the snapshot was taken
+	explicit Execution(const ExecutionSnapshot& snapshot);
+	Execution(const Execution&) = delete;
+	Execution(Execution&&) noexcept = default;
+	Execution& operator=(const Execution&) = delete;
+	Execution& operator=(Execution&&) noexcept = default;
+	// identifiers lexed without an interner are interned with the one given
+	static CompiledCode Compile(const AST& tree, Interner& code_interner, Backend code_backend);
+	// returns the value of the last statement, if it is an expression (as the python interpreter echoes it)
+	std::optional<Value> RunCode(const AST& tree);
+	// code must be compiled with this interner (of either backend).
+	// the symbol table grows to a slot per name in the interner first, so names may be added between runs (as in the interface).
+	std::optional<Value> RunCompiled(const CompiledCode& code);
+	std::optional<Value> RunBytecode(const Bytecode& code);
+	Backend GetBackend() const;
+	const SymbolTable& GetSymbolTable() const;
+	// code must be lexed with this interner before it is run
+	Interner& GetInterner();
+	const Interner& GetInterner() const;
+	ExecutionSnapshot Snapshot() const;
+	// returns to the state of the snapshot, backend included (it may have been taken from another execution)
+	void Restore(const ExecutionSnapshot& snapshot);
 private:
-	std::unordered_map<std::string, ValueType> symbol_table{};
+	CopyOnWrite<Interner> interner{};
+	Backend backend = Backend::Bytecode;
+	CopyOnWrite<SymbolTable> symbol_table{};
+	std::vector<Value> stack{};	// kept between runs, so that it is only allocated as code grows
 };
 
+// bytecode is cached on disk, in a __pysubcache__ directory next to the file. a read of an unchanged file loads the tokens and
+// bytecode from there instead of lexing, parsing, and compiling it again. (the cache is keyed by a 128-bit hash of the source,
+// cache_version, and the interpreter's build; an unusable cache is ignored, and failing to write one is not an error.)
 class FileExecution {
 public:
-	explicit FileExecution(const std::string& file_name);
+	explicit FileExecution(const std::string& file_name, Backend backend = Backend::Bytecode);
+	// re-reads a file, only lexing (and later parsing) the blocks that differ from the previous read.
+	// previous need not be of the same file; blocks are matched by their text alone. the backend is that of previous.
+	explicit FileExecution(const std::string& file_name, const FileExecution& previous);
+	FileExecution(const FileExecution&) = delete;
+	FileExecution(FileExecution&&) noexcept = default;
+	FileExecution& operator=(const FileExecution&) = delete;
+	FileExecution& operator=(FileExecution&&) noexcept = default;
 	void Run();
-	const std::string& GetFileString() const;
-	const std::vector<Token>& GetFileTokens() const;
-	const std::unordered_map<std::string, ValueType>& GetSymbolTable() const;
+	// the bytecode of each block, headed by the line it starts on (the backend must be Backend::Bytecode)
+	std::string Disassemble();
+	std::string_view GetFileString() const;
+	std::vector<Token> GetFileTokens() const;
+	const SymbolTable& GetSymbolTable() const;
+	const Interner& GetInterner() const;
+	// the state the last run ended in (e.g. to continue from in an InterfaceExecution)
+	ExecutionSnapshot Snapshot() const;
+	// whether the file was loaded from its cache, rather than lexed
+	bool IsCached() const;
 private:
+	// bump whenever the format of the cache, the tokens, or the bytecode changes
+	static constexpr uint32_t cache_version = 4;
+	// caches are only read by the build that wrote them (which also covers changes made without bumping cache_version)
+	static constexpr std::string_view interpreter_build = __DATE__ " " __TIME__;
+	static constexpr uint32_t cache_magic = 0x63627970;	// "pybc"
+
+	// the tree views into a copy of the block's text rather than the source, so that later reads can reuse it without the whole source
+	struct ParsedBlock {
+		std::string text{};
+		std::unique_ptr<AST> tree{};	// null (like text) for code loaded from the cache
+		CompiledCode code{};	// compiled with the file's interner
+	};
+	// an unindented line and the lines indented under it (as opposed to a block of code in the grammar).
+	// blocks are lexed and parsed independently of each other, so they are the unit that is reused when a file is read again.
+	// they are looked up by a hash of their text taken on read, and matched by comparing the text itself.
+	struct Block {
+		uint32_t offset = 0;
+		uint32_t size = 0;
+		size_t hash = 0;
+		size_t first_token = 0;
+		size_t last_token = 0;
+		std::shared_ptr<const ParsedBlock> parsed{};	// parsed and compiled on the first run
+	};
+
+	Backend backend = Backend::Bytecode;
 	Execution execution{};
-	std::string file_string;
-	std::vector<Token> file_tokens{};
-	static std::string ReadEntireFile(std::filesystem::path file_path);
+	// the text of the file as it was read, which tokens view into (shared so that copies keep it).
+	// the file itself is only mapped while it is copied, so editing it after a read changes nothing until it is read again.
+	std::shared_ptr<const std::string> source;
+	// the file is lexed once, on read. each run starts from (a share of) the interner its identifiers were lexed with.
+	CopyOnWrite<Interner> file_interner{};
+	std::shared_ptr<const TokenBuffer> tokens;
+	std::vector<Block> blocks{};
+	std::filesystem::path cache_path{};
+	bool is_cached = false;
+
+	static std::vector<Block> SplitBlocks(std::string_view text);
+	void FindBlockTokens();
+	void ParseBlocks();
+	static std::filesystem::path GetCachePath(const std::filesystem::path& file_path);
+	bool TryLoadCache();
+	void WriteCache() const;
 };
 
 class InterfaceExecution {
 public:
-	void Run(const std::vector<Token>& tokens);
-	const std::unordered_map<std::string, ValueType>& GetSymbolTable() const;
+	InterfaceExecution() = default;
+	explicit InterfaceExecution(Backend backend) : execution(backend) {}
+	// a session continuing from the snapshot
+	explicit InterfaceExecution(const ExecutionSnapshot& snapshot) : execution(snapshot) {}
+	InterfaceExecution(const InterfaceExecution&) = delete;
+	InterfaceExecution(InterfaceExecution&&) noexcept = default;
+	InterfaceExecution& operator=(const InterfaceExecution&) = delete;
+	InterfaceExecution& operator=(InterfaceExecution&&) noexcept = default;
+	std::optional<Value> Run(const std::vector<Token>& tokens);	// tokens must be lexed with GetInterner()
+	// the bytecode of the last code run (the backend must be Backend::Bytecode)
+	std::string Disassemble() const;
+	const SymbolTable& GetSymbolTable() const;
+	Interner& GetInterner();
+	const Interner& GetInterner() const;
+	ExecutionSnapshot Snapshot() const;
+	void Restore(const ExecutionSnapshot& snapshot);
 private:
 	Execution execution{};
+	CompiledCode last_code{};
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,237 @@
+#ifndef FLAT_MAP_HPP
+#define FLAT_MAP_HPP
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <tuple>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PYSUB_FLAT_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+// an open-addressing hash map in the style of abseil's swiss tables, which iterates in insertion order.
+// entries are stored one after another in a vector, in the order they were inserted; the table holds only their indices,
+// with a control byte per slot (empty, or 7 bits of the key's hash), so a probe compares a group of 16 slots at once
+// and only looks at keys whose bits match.
+// entries are never erased (the symbols it is used for never are), so there are no tombstones.
+// as with std::vector, inserting invalidates references and iterators to entries. an insertion that throws leaves the entries as they were.
+template <typename Key, typename T, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatMap {
+public:
+	using key_type = Key;
+	using mapped_type = T;
+	using value_type = std::pair<const Key, T>;
+	using iterator = typename std::vector<value_type>::iterator;
+	using const_iterator = typename std::vector<value_type>::const_iterator;
+
+	FlatMap() = default;
+	FlatMap(const FlatMap& other) = default;
+	FlatMap(FlatMap&& other) noexcept = default;
+	// entries have const keys, so they cannot be assigned over
+	FlatMap& operator=(const FlatMap& other) {
+		if (this != &other) {
+			FlatMap copy(other);
+			*this = std::move(copy);
+		}
+		return *this;
+	}
+	FlatMap& operator=(FlatMap&& other) noexcept = default;
+
+	iterator begin() noexcept { return entries.begin(); }
+	iterator end() noexcept { return entries.end(); }
+	const_iterator begin() const noexcept { return entries.begin(); }
+	const_iterator end() const noexcept { return entries.end(); }
+	size_t size() const noexcept { return entries.size(); }
+	bool empty() const noexcept { return entries.empty(); }
+	// the number of slots, which is kept above size() by the maximum load factor
+	size_t bucket_count() const noexcept { return controls.size(); }
+
+	void clear() noexcept {
+		entries.clear();
+		std::fill(controls.begin(), controls.end(), empty_control);
+	}
+	// makes room for count entries without growing the table
+	void reserve(size_t count) {
+		entries.reserve(count);
+		if (count > GetMaxLoad(controls.size())) {
+			size_t slot_count = group_size;
+			while (count > GetMaxLoad(slot_count)) {
+				slot_count *= 2;
+			}
+			Rehash(slot_count);
+		}
+	}
+
+	iterator find(const Key& key) {
+		return FindIterator(*this, key);
+	}
+	const_iterator find(const Key& key) const {
+		return FindIterator(*this, key);
+	}
+	bool contains(const Key& key) const {
+		return Find(key, GetHash(key)) != not_found;
+	}
+	T& at(const Key& key) {
+		return At(*this, key);
+	}
+	const T& at(const Key& key) const {
+		return At(*this, key);
+	}
+
+	// inserts key with a value made from args, unless it is already present. returns the entry, and whether it was inserted.
+	template <typename... Args>
+	std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+		const size_t hash = GetHash(key);
+		if (const size_t index = Find(key, hash); index != not_found) {
+			return { begin() + index, false };
+		}
+		ReserveSlot();
+		entries.emplace_back(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+		PlaceEntry(static_cast<uint32_t>(entries.size() - 1), hash);
+		return { end() - 1, true };
+	}
+	template <typename M>
+	std::pair<iterator, bool> insert_or_assign(const Key& key, M&& value) {
+		const size_t hash = GetHash(key);
+		if (const size_t index = Find(key, hash); index != not_found) {
+			entries[index].second = std::forward<M>(value);
+			return { begin() + index, false };
+		}
+		ReserveSlot();
+		entries.emplace_back(key, std::forward<M>(value));
+		PlaceEntry(static_cast<uint32_t>(entries.size() - 1), hash);
+		return { end() - 1, true };
+	}
+	T& operator[](const Key& key) {
+		return try_emplace(key).first->second;
+	}
+
+	// the same entries, in any order (as for std::unordered_map)
+	friend bool operator==(const FlatMap& left, const FlatMap& right) {
+		if (left.size() != right.size()) {
+			return false;
+		}
+		return std::ranges::all_of(left, [&right](const value_type& entry) {
+			const auto iter = right.find(entry.first);
+			return iter != right.end() && iter->second == entry.second;
+		});
+	}
+private:
+	static constexpr size_t group_size = 16;
+	static constexpr int8_t empty_control = INT8_MIN;	// a full slot's control is 7 bits of hash, so never negative
+	static constexpr size_t not_found = SIZE_MAX;
+
+	std::vector<value_type> entries{};
+	std::vector<int8_t> controls{};	// a multiple of group_size, and a power of 2 (or empty, before the first insertion)
+	std::vector<uint32_t> slots{};	// the index in entries of each full slot
+
+	// at most 7/8 full, as in abseil
+	static size_t GetMaxLoad(size_t slot_count) {
+		return slot_count - slot_count / 8;
+	}
+
+	static size_t GetHash(const Key& key) {
+		// std::hash of an integer is usually the integer itself, so the bits are mixed (a fibonacci hash) before they are split
+		const uint64_t hash = static_cast<uint64_t>(Hash{}(key)) * 0x9E3779B97F4A7C15ull;
+		return static_cast<size_t>(hash ^ (hash >> 32));
+	}
+	static int8_t GetControl(size_t hash) {
+		return static_cast<int8_t>(hash & 0x7F);
+	}
+
+	// bit i is set for each slot i in the group of 16 at first with the given control
+	static uint32_t MatchControl(const int8_t* first, int8_t control) {
+#ifdef PYSUB_FLAT_MAP_SSE2
+		const __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(control))));
+#else
+		uint32_t mask = 0;
+		for (size_t i = 0; i < group_size; ++i) {
+			mask |= static_cast<uint32_t>(first[i] == control) << i;
+		}
+		return mask;
+#endif
+	}
+
+	// for const and non-const maps alike
+	template <typename Self>
+	static auto FindIterator(Self& self, const Key& key) {
+		const size_t index = self.Find(key, GetHash(key));
+		return index == not_found ? self.end() : self.begin() + index;
+	}
+	template <typename Self>
+	static auto& At(Self& self, const Key& key) {
+		const size_t index = self.Find(key, GetHash(key));
+		if (index == not_found) {
+			throw std::out_of_range("key not found");
+		}
+		return self.entries[index].second;
+	}
+
+	// probes groups in triangular steps (1, 2, 3, ... groups on), which visits every group of a power of 2.
+	// without erasure, a key cannot be past the first group that has an empty slot.
+	size_t Find(const Key& key, size_t hash) const {
+		if (controls.empty()) {
+			return not_found;
+		}
+		const size_t group_mask = controls.size() / group_size - 1;
+		const int8_t control = GetControl(hash);
+		size_t group = (hash >> 7) & group_mask;
+		for (size_t step = 1;; ++step) {
+			const int8_t* group_controls = controls.data() + group * group_size;
+			for (uint32_t matches = MatchControl(group_controls, control); matches != 0; matches &= matches - 1) {
+				const uint32_t index = slots[group * group_size + std::countr_zero(matches)];
+				if (KeyEqual{}(entries[index].first, key)) {
+					return index;
+				}
+			}
+			if (MatchControl(group_controls, empty_control) != 0) {
+				return not_found;
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+
+	// makes room in the table for one more entry, before the entry is made.
+	// the entry is only given its slot once it has been appended, so that an entry that fails to construct leaves no slot behind.
+	void ReserveSlot() {
+		if (entries.size() >= UINT32_MAX) {
+			throw std::length_error("too many entries");
+		}
+		if (entries.size() + 1 > GetMaxLoad(controls.size())) {
+			Rehash(std::max(group_size, controls.size() * 2));
+		}
+	}
+	void PlaceEntry(uint32_t index, size_t hash) noexcept {
+		const size_t group_mask = controls.size() / group_size - 1;
+		size_t group = (hash >> 7) & group_mask;
+		for (size_t step = 1;; ++step) {
+			if (const uint32_t empties = MatchControl(controls.data() + group * group_size, empty_control); empties != 0) {
+				const size_t slot = group * group_size + std::countr_zero(empties);
+				controls[slot] = GetControl(hash);
+				slots[slot] = index;
+				return;
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+	void Rehash(size_t slot_count) {
+		// allocated before either is replaced, so that a failed allocation leaves the table as it was
+		std::vector<int8_t> new_controls(slot_count, empty_control);
+		std::vector<uint32_t> new_slots(slot_count, 0);
+		controls.swap(new_controls);
+		slots.swap(new_slots);
+		for (size_t i = 0; i < entries.size(); ++i) {
+			PlaceEntry(static_cast<uint32_t>(i), GetHash(entries[i].first));
+		}
+	}
+};
+
+#endif
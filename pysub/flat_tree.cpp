@@ -0,0 +1,205 @@
+#include "flat_tree.hpp"
+
+#include <sstream>
+#include <stdexcept>
+#include <limits>
+#include <cassert>
+
+FlatTree::FlatTree(const AST& tree) {
+	// most trees are a block of a line or two, so room for a typical statement saves growing the vectors several times
+	constexpr size_t typical_nodes = 32;
+	constexpr size_t typical_depth = 16;
+	nodes.reserve(typical_nodes);
+	tokens.reserve(typical_nodes);
+	roots.reserve(tree.statements.size());
+	std::vector<Frame> stack{};
+	stack.reserve(typical_depth);
+	for (const Statement* statement : tree.statements) {
+		if (statement->kind == NodeKind::Assignment) {
+			// the value, then the assignment itself
+			const Assignment* assignment = static_cast<const Assignment*>(statement);
+			Append(assignment->value, stack);
+			AppendNode(NodeKind::Assignment, nodes.back().size + 1, assignment->name);
+		}
+		else {
+			Append(static_cast<const Expression*>(statement), stack);
+		}
+		roots.push_back(static_cast<uint32_t>(nodes.size() - 1));
+	}
+}
+
+void FlatTree::Append(const Expression* root, std::vector<Frame>& stack) {
+	// post-order without recursion (trees can be deeper than the native stack allows).
+	// an expression is visited twice: first to push its children, then (once they have been appended) to append itself.
+	// an atom that would be appended next is appended at once, rather than pushed.
+	auto Push = [&stack](const Expression* expression) {
+		stack.push_back({ expression, 0, false });
+	};
+	auto PushNext = [this, &Push](const Expression* expression) {
+		if (expression->kind == NodeKind::Atom) {
+			AppendNode(NodeKind::Atom, 1, static_cast<const Atom*>(expression)->value);
+		}
+		else {
+			Push(expression);
+		}
+	};
+	PushNext(root);
+	while (!stack.empty()) {
+		// an iteration appends up to two nodes, and an assignment appends one more
+		if (nodes.size() >= std::numeric_limits<uint32_t>::max() - 3) {
+			throw std::length_error("tree is too large to index with 32-bit indices");
+		}
+		Frame& frame = stack.back();
+		const Expression* expression = frame.expression;
+		if (expression->kind == NodeKind::Atom) {
+			AppendNode(NodeKind::Atom, 1, static_cast<const Atom*>(expression)->value);
+			stack.pop_back();
+			continue;
+		}
+		if (!frame.visited) {
+			frame.visited = true;
+			frame.first_node = static_cast<uint32_t>(nodes.size());
+			// the last child pushed is appended first, so children are pushed in reverse
+			switch (expression->kind) {
+			case NodeKind::BinaryExpression: {
+				const BinaryExpression* binary_expression = static_cast<const BinaryExpression*>(expression);
+				if (binary_expression->left->kind == NodeKind::Atom) {
+					PushNext(binary_expression->left);
+					PushNext(binary_expression->right);
+				}
+				else {
+					Push(binary_expression->right);
+					Push(binary_expression->left);
+				}
+				break;
+			}
+			case NodeKind::UnaryExpression:
+				PushNext(static_cast<const UnaryExpression*>(expression)->expression);
+				break;
+			case NodeKind::Grouping:
+				PushNext(static_cast<const Grouping*>(expression)->expression);
+				break;
+			case NodeKind::Atom:
+			case NodeKind::Assignment:
+				assert(false && "an assignment is not an expression");
+				break;
+			}
+			continue;
+		}
+
+		const uint32_t size = static_cast<uint32_t>(nodes.size()) - frame.first_node + 1;
+		switch (expression->kind) {
+		case NodeKind::BinaryExpression:
+			AppendNode(NodeKind::BinaryExpression, size, static_cast<const BinaryExpression*>(expression)->op);
+			break;
+		case NodeKind::UnaryExpression:
+			AppendNode(NodeKind::UnaryExpression, size, static_cast<const UnaryExpression*>(expression)->op);
+			break;
+		case NodeKind::Grouping:
+			AppendGrouping(size);
+			break;
+		case NodeKind::Atom:
+		case NodeKind::Assignment:
+			assert(false && "an assignment is not an expression");
+			break;
+		}
+		stack.pop_back();
+	}
+}
+
+void FlatTree::AppendNode(NodeKind kind, uint32_t size, const Token& token) {
+	nodes.push_back({ .kind = kind, .size = size, .token = static_cast<uint32_t>(tokens.size()) });
+	tokens.push_back(token);
+}
+
+void FlatTree::AppendGrouping(uint32_t size) {
+	nodes.push_back({ .kind = NodeKind::Grouping, .size = size, .token = no_token });
+}
+
+const std::vector<FlatTree::Node>& FlatTree::GetNodes() const {
+	return nodes;
+}
+
+const std::vector<uint32_t>& FlatTree::GetRoots() const {
+	return roots;
+}
+
+const Token& FlatTree::GetToken(uint32_t node_idx) const {
+	assert(nodes[node_idx].token != no_token);
+	return tokens[nodes[node_idx].token];
+}
+
+uint32_t FlatTree::GetOnlyChild(uint32_t node_idx) const {
+	assert(nodes[node_idx].kind == NodeKind::UnaryExpression || nodes[node_idx].kind == NodeKind::Grouping || nodes[node_idx].kind == NodeKind::Assignment);
+	return node_idx - 1;
+}
+
+uint32_t FlatTree::GetLeftChild(uint32_t node_idx) const {
+	assert(nodes[node_idx].kind == NodeKind::BinaryExpression);
+	return node_idx - 1 - nodes[node_idx - 1].size;
+}
+
+uint32_t FlatTree::GetRightChild(uint32_t node_idx) const {
+	assert(nodes[node_idx].kind == NodeKind::BinaryExpression);
+	return node_idx - 1;
+}
+
+std::string FlatTree::ToString() const {
+	// in post-order, each node's operands are the last strings built
+	std::vector<std::string> operands{};
+	std::string result{};
+	size_t statement_idx = 0;
+	for (uint32_t i = 0; i < nodes.size(); ++i) {
+		std::ostringstream stream{};
+		switch (nodes[i].kind) {
+		case NodeKind::BinaryExpression: {
+			std::string right = std::move(operands.back());
+			operands.pop_back();
+			stream << '(' << operands.back() << ' ';
+			std::visit([&stream](const auto& v) {stream << v; }, GetToken(i).value);
+			stream << ' ' << right << ')';
+			operands.pop_back();
+			break;
+		}
+		case NodeKind::UnaryExpression:
+			std::visit([&stream](const auto& v) {stream << v; }, GetToken(i).value);
+			stream << (GetToken(i).category == Category::LogicalOperator ? " " : "") << operands.back();
+			operands.pop_back();
+			break;
+		case NodeKind::Grouping:
+			stream << '(' << operands.back() << ')';
+			operands.pop_back();
+			break;
+		case NodeKind::Atom:
+			std::visit([&stream](const auto& v) {stream << v; }, GetToken(i).value);
+			break;
+		case NodeKind::Assignment:
+			stream << std::get<std::string_view>(GetToken(i).value) << " = " << operands.back();
+			operands.pop_back();
+			break;
+		}
+		operands.push_back(stream.str());
+		if (i == roots[statement_idx]) {
+			assert(operands.size() == 1);
+			result += operands.back() + '\n';
+			operands.clear();
+			++statement_idx;
+		}
+	}
+	return result;
+}
+
+bool FlatTree::operator==(const FlatTree& other) const {
+	// trees with the same kinds and subtree sizes in post-order have the same shape
+	if (nodes.size() != other.nodes.size() || roots != other.roots) {
+		return false;
+	}
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		const Node& l = nodes[i];
+		const Node& r = other.nodes[i];
+		if (l.kind != r.kind || l.size != r.size || (l.token != no_token && tokens[l.token] != other.tokens[r.token])) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,59 @@
+#ifndef FLAT_TREE_HPP
+#define FLAT_TREE_HPP
+
+#include "parser.hpp"
+
+#include <string>
+#include <vector>
+
+// an AST lowered into one contiguous vector of nodes, in post-order (every node comes after its children).
+// a node records the size of its subtree, so its children are found by index:
+//	the last child is the node just before it, and each earlier child is just before the subtree of the one after it.
+// statements are stored one after another; roots holds the index of each statement's root.
+// walking the tree is a loop over the vector, with no pointers to chase and no recursion, so the compilers walk this rather than the AST.
+class FlatTree {
+public:
+	static constexpr uint32_t no_token = UINT32_MAX;
+
+	// tokens are kept out of line, so that a walk over the kinds and sizes of nodes stays within a few cache lines
+	struct Node {
+		NodeKind kind;
+		uint32_t size;	// of the subtree (including this node)
+		uint32_t token;	// index into tokens: the value of an atom, the operator of an expression, or the name assigned to (no_token for a grouping)
+	};
+	static_assert(sizeof(Node) == 12);
+
+	FlatTree() = default;
+	explicit FlatTree(const AST& tree);
+
+	const std::vector<Node>& GetNodes() const;
+	const std::vector<uint32_t>& GetRoots() const;
+	const Token& GetToken(uint32_t node_idx) const;
+	// children of the node at node_idx, in order
+	uint32_t GetOnlyChild(uint32_t node_idx) const;	// of a unary expression, grouping, or assignment
+	uint32_t GetLeftChild(uint32_t node_idx) const;	// of a binary expression
+	uint32_t GetRightChild(uint32_t node_idx) const;	// of a binary expression
+
+	// each statement on its own line, with binary expressions parenthesized (e.g. "(1 + (2 * 3))")
+	std::string ToString() const;
+	bool operator==(const FlatTree& other) const;
+private:
+	// an expression waiting to be appended, once its children are
+	struct Frame {
+		const Expression* expression;
+		uint32_t first_node;	// where the subtree starts, once visited
+		bool visited;
+	};
+
+	std::vector<Node> nodes{};
+	std::vector<Token> tokens{};
+	std::vector<uint32_t> roots{};
+
+	void AppendNode(NodeKind kind, uint32_t size, const Token& token);
+	void AppendGrouping(uint32_t size);
+
+	// stack is only passed in to be reused between statements
+	void Append(const Expression* root, std::vector<Frame>& stack);
+};
+
+#endif
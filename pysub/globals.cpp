@@ -1,7 +1,67 @@
 #include "globals.hpp"
+#include "bigint.hpp"
 
 #include <iterator>
 #include <algorithm>
+#include <cassert>
+
+namespace {
+	struct KeywordEntry {
+		std::string_view keyword;
+		TokenKind kind;
+	};
+
+	constexpr std::array<KeywordEntry, 10> keywords{ {
+		{"print", TokenKind::Print}, {"if", TokenKind::If}, {"elif", TokenKind::Elif}, {"else", TokenKind::Else}, {"while", TokenKind::While},
+		{"int", TokenKind::Int}, {"input", TokenKind::Input}, {"and", TokenKind::And}, {"or", TokenKind::Or}, {"not", TokenKind::Not}
+	} };
+	constexpr size_t max_keyword_length = 5;
+
+	// perfect hash over the keyword list: every keyword lands in its own slot, so a lookup is one hash and one compare
+	constexpr size_t KeywordHash(std::string_view string) {
+		return (string.size() * 3 + (static_cast<unsigned char>(string.front()) + static_cast<unsigned char>(string.back())) * 7) % 16;
+	}
+
+	constexpr std::array<KeywordEntry, 16> MakeKeywordTable() {
+		std::array<KeywordEntry, 16> table{};
+		for (const auto& entry : keywords) {
+			table[KeywordHash(entry.keyword)] = entry;
+		}
+		return table;
+	}
+
+	constexpr std::array<KeywordEntry, 16> keyword_table = MakeKeywordTable();
+
+	constexpr bool IsKeywordHashPerfect() {
+		return std::all_of(std::begin(keywords), std::end(keywords), [](const auto& entry) {return keyword_table[KeywordHash(entry.keyword)].keyword == entry.keyword; });
+	}
+	static_assert(IsKeywordHashPerfect(), "keyword hash has a collision; adjust KeywordHash");
+
+	constexpr std::array<TokenKind, 256> MakeOperatorKindTable(bool followed_by_equals) {
+		// kind of an operator given its first char, for both the one-char form and the "c=" form
+		std::array<TokenKind, 256> table{};
+		auto set = [&table](char c, TokenKind kind) {table[static_cast<unsigned char>(c)] = kind; };
+		if (followed_by_equals) {
+			set('=', TokenKind::Equal);
+			set('!', TokenKind::NotEqual);
+			set('<', TokenKind::LessEqual);
+			set('>', TokenKind::GreaterEqual);
+			return table;
+		}
+		set('+', TokenKind::Plus);
+		set('-', TokenKind::Minus);
+		set('*', TokenKind::Star);
+		set('/', TokenKind::Slash);
+		set('%', TokenKind::Percent);
+		set('<', TokenKind::Less);
+		set('>', TokenKind::Greater);
+		set('=', TokenKind::Assign);
+		return table;
+	}
+
+	constexpr std::array<TokenKind, 256> single_operator_kinds = MakeOperatorKindTable(false);
+	constexpr std::array<TokenKind, 256> compound_operator_kinds = MakeOperatorKindTable(true);
+}
 
 std::string Utilities::ToLowerCase(std::string_view original) {
 	std::string lowercase{};
@@ -26,11 +86,29 @@ void Utilities::TrimLeadingAndTrailingWhitespaces(std::string& string) {
 }
 
 bool Utilities::IsWhitespace(char c) {
-	return c == ' ' || c == '\t';
+	return GetCharClass(c) == CharClass::Whitespace;
 }
 
 bool Utilities::IsSymbol(char c) {
-	return c == '\'' || c == '\"' || c == '(' || c == ')' || c == ':' || c == ', ' || c == '#';
+	switch (GetCharClass(c)) {
+	case CharClass::Quote:
+	case CharClass::NumberSign:
+	case CharClass::LeftParenthesis:
+	case CharClass::RightParenthesis:
+	case CharClass::Colon:
+	case CharClass::Comma:
+		return true;
+	case CharClass::Invalid:
+	case CharClass::EndOfFile:
+	case CharClass::Newline:
+	case CharClass::Whitespace:
+	case CharClass::Digit:
+	case CharClass::Letter:
+	case CharClass::RelationalOrAssignmentOperator:
+	case CharClass::ArithmeticOperator:
+		return false;
+	}
+	return false;
 }
 
 bool Utilities::IsOperator(char c) {
@@ -42,20 +120,46 @@ bool Utilities::IsNewTokenChar(char c) {
 	return IsWhitespace(c) || IsSymbol(c) || IsOperator(c);
 }
 
-bool Utilities::IsNonLogicalOperatorKeyword(std::string_view string) {
-	return string == "print" || string == "if" || string == "elif" || string == "else" || string == "while" || string == "int" || string == "input";
+TokenKind Utilities::GetKeywordKind(std::string_view string) {
+	// returns TokenKind::None if the string is not a keyword (including logical operator keywords)
+	if (string.empty() || string.size() > max_keyword_length) {
+		return TokenKind::None;
+	}
+	const KeywordEntry& entry = keyword_table[KeywordHash(string)];
+	return entry.keyword == string ? entry.kind : TokenKind::None;
 }
 
-bool Utilities::IsLogicalOperatorKeyword(std::string_view string) {
-	return string == "and" || string == "or" || string == "not";
+TokenKind Utilities::GetOperatorKind(std::string_view string) {
+	// returns TokenKind::None if the string is not an arithmetic, relational, or assignment operator
+	if (string.size() == 1) {
+		return single_operator_kinds[static_cast<unsigned char>(string.front())];
+	}
+	if (string.size() == 2 && string.back() == '=') {
+		return compound_operator_kinds[static_cast<unsigned char>(string.front())];
+	}
+	return TokenKind::None;
 }
 
 bool Utilities::IsRelationalOrAssignmentOperator(char c) {
-	return c == '=' || c == '<' || c == '>' || c == '!';
+	return GetCharClass(c) == CharClass::RelationalOrAssignmentOperator;
 }
 
 bool Utilities::IsArithmeticOperator(char c) {
-	return c == '+' || c == '-' || c == '*' || c == '/' || c == '%';
+	return GetCharClass(c) == CharClass::ArithmeticOperator;
+}
+
+bool Utilities::IsComparison(TokenKind kind) {
+	switch (kind) {
+	case TokenKind::Equal:
+	case TokenKind::NotEqual:
+	case TokenKind::Less:
+	case TokenKind::LessEqual:
+	case TokenKind::Greater:
+	case TokenKind::GreaterEqual:
+		return true;
+	default:
+		return false;
+	}
 }
 
 std::optional<std::string> Utilities::GetCommandArgument(const std::vector<Token>& token_line) {
@@ -86,7 +190,7 @@ std::optional<std::string> Utilities::GetCommandArgument(const std::vector<Token
 		throw std::invalid_argument("expected identifier or string literal in command argument");
 	}
 	if (iter->category != Category::RightParenthesis) {
-		argument = std::get<std::string>(iter->value);
+		argument = std::get<std::string_view>(iter->value);
 		++iter;
 	}
 	if (iter == std::end(token_line) || iter->category != Category::RightParenthesis) {
@@ -104,7 +208,19 @@ std::optional<std::string> Utilities::GetCommandArgument(const std::vector<Token
 	return argument;
 }
 
+Value Utilities::GetLiteralValue(const Token& literal) {
+	assert(literal.category == Category::NumericLiteral);
+	if (const int64_t* integer = std::get_if<int64_t>(&literal.value)) {
+		return *integer;
+	}
+	return Value(BigInt::FromString(std::get<std::string_view>(literal.value)));
+}
+
 std::exception Utilities::AddContext(const std::string& context, const std::exception& ex) {
 	// const std::string& instead of std::string_view because of inevitable copy
 	return std::exception{ std::string{context + ": " + ex.what()}.c_str() };
+}
+
+std::string Utilities::LocationToString(SourceLocation location) {
+	return "line " + std::to_string(location.line) + ", column " + std::to_string(location.column);
 }
\ No newline at end of file
@@ -1,7 +1,12 @@
 #ifndef GLOBALS_HPP
 #define GLOBALS_HPP
 
+#include "value.hpp"
+
 #include <string>
+#include <string_view>
+#include <array>
+#include <cstdint>
 #include <vector>
 #include <variant>
 #include <optional>
@@ -27,17 +32,79 @@ enum class Category
     Newline
 };
 
-using ValueType = std::variant<std::string, int>;
+// one kind per operator and keyword (None for everything else), so they can be told apart without comparing strings
+enum class TokenKind
+{
+    None,
+    Plus,
+    Minus,
+    Star,
+    Slash,
+    Percent,
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Assign,
+    And,
+    Or,
+    Not,
+    Print,
+    If,
+    Elif,
+    Else,
+    While,
+    Int,
+    Input
+};
+
+// lexer dispatch is done on the class of a character rather than on the character itself
+enum class CharClass : uint8_t
+{
+    Invalid,
+    EndOfFile,
+    Newline,
+    Whitespace,
+    Digit,
+    Letter,	// includes '_'
+    Quote,
+    NumberSign,
+    LeftParenthesis,
+    RightParenthesis,
+    Colon,
+    Comma,
+    RelationalOrAssignmentOperator,
+    ArithmeticOperator
+};
+
+// identifiers are interned to dense ids (see Interner), so names are never hashed or compared after lexing
+using SymbolId = uint32_t;
+inline constexpr SymbolId no_symbol = UINT32_MAX;
+
+// text payloads are views into the lexed source (no per-token allocation), so the source must outlive its tokens.
+// numeric literals too large for 64 bits are views of their digits.
+using TokenValue = std::variant<std::string_view, int64_t>;
 
 struct Token {
-    ValueType value;
+    TokenValue value;
     Category category;
+    TokenKind kind = TokenKind::None;
+    SymbolId symbol = no_symbol;	// set for identifiers lexed with an interner
 
     bool operator==(const Token& rhs) const {
+        // kind and symbol are derived from the value, so they are not compared (hand-built tokens may leave them unset)
         return this->category == rhs.category && this->value == rhs.value;
     }
 };
 
+// 1-based, as editors count them. columns count bytes (a tab is one column).
+struct SourceLocation {
+    uint32_t line = 1;
+    uint32_t column = 1;
+};
+
 namespace Utilities {
     // string processing
     std::string ToLowerCase(std::string_view string);
@@ -45,20 +112,62 @@ namespace Utilities {
     void TrimLeadingAndTrailingWhitespaces(std::string& string);
 
     // analysis
+    constexpr CharClass GetCharClass(char c);
     bool IsWhitespace(char c);
     bool IsSymbol(char c);
     bool IsOperator(char c);
     bool IsNewTokenChar(char c);
-    bool IsNonLogicalOperatorKeyword(std::string_view string);
-    bool IsLogicalOperatorKeyword(std::string_view string);
+    TokenKind GetKeywordKind(std::string_view string);
+    TokenKind GetOperatorKind(std::string_view string);
     bool IsRelationalOrAssignmentOperator(char c);
     bool IsArithmeticOperator(char c);
+    bool IsComparison(TokenKind kind);	// the operators that chain ("a < b < c")
 
     // parsing
     std::optional<std::string> GetCommandArgument(const std::vector<Token>& token_line);
+    // the value of a numeric literal (literals too large for 64 bits hold their digits)
+    Value GetLiteralValue(const Token& literal);
 
     // exceptions
     std::exception AddContext(const std::string& context, const std::exception& ex);
+    std::string LocationToString(SourceLocation location);
+
+    constexpr std::array<CharClass, 256> MakeCharClassTable() {
+        std::array<CharClass, 256> table{};	// everything not listed is CharClass::Invalid
+        auto set = [&table](char c, CharClass char_class) {table[static_cast<unsigned char>(c)] = char_class; };
+        for (char c = '0'; c <= '9'; ++c) {
+            set(c, CharClass::Digit);
+        }
+        for (char c = 'a'; c <= 'z'; ++c) {
+            set(c, CharClass::Letter);
+            set(static_cast<char>(c - 'a' + 'A'), CharClass::Letter);
+        }
+        set('_', CharClass::Letter);
+        set('\0', CharClass::EndOfFile);
+        set('\n', CharClass::Newline);
+        set(' ', CharClass::Whitespace);
+        set('\t', CharClass::Whitespace);
+        set('\'', CharClass::Quote);
+        set('\"', CharClass::Quote);
+        set('#', CharClass::NumberSign);
+        set('(', CharClass::LeftParenthesis);
+        set(')', CharClass::RightParenthesis);
+        set(':', CharClass::Colon);
+        set(',', CharClass::Comma);
+        for (char c : { '=', '<', '>', '!' }) {
+            set(c, CharClass::RelationalOrAssignmentOperator);
+        }
+        for (char c : { '+', '-', '*', '/', '%' }) {
+            set(c, CharClass::ArithmeticOperator);
+        }
+        return table;
+    }
+
+    inline constexpr std::array<CharClass, 256> char_class_table = MakeCharClassTable();
+
+    constexpr CharClass GetCharClass(char c) {
+        return char_class_table[static_cast<unsigned char>(c)];
+    }
 };
 
 class UnexpectedEndOfFile : public std::runtime_error {
@@ -0,0 +1,48 @@
+#include "interner.hpp"
+
+#include <cassert>
+
+Interner::Interner(const Interner& other) : names(other.names) {
+	// the copied keys would view into other's names, so they are rebuilt
+	ids.reserve(names.size());
+	for (size_t i = 0; i < names.size(); ++i) {
+		ids.try_emplace(names[i], static_cast<SymbolId>(i));
+	}
+}
+
+Interner& Interner::operator=(const Interner& other) {
+	if (this != &other) {
+		Interner copy(other);
+		*this = std::move(copy);
+	}
+	return *this;
+}
+
+SymbolId Interner::Intern(std::string_view name) {
+	if (auto iter = ids.find(name); iter != std::end(ids)) {
+		return iter->second;
+	}
+	if (names.size() >= no_symbol) {
+		throw std::length_error("too many distinct identifiers");
+	}
+	const auto new_id = static_cast<SymbolId>(names.size());
+	const std::string& new_name = names.emplace_back(name);
+	ids.try_emplace(new_name, new_id);
+	return new_id;
+}
+
+std::optional<SymbolId> Interner::Find(std::string_view name) const {
+	if (auto iter = ids.find(name); iter != std::end(ids)) {
+		return iter->second;
+	}
+	return {};
+}
+
+std::string_view Interner::GetName(SymbolId id) const {
+	assert(id < names.size());
+	return names[id];
+}
+
+size_t Interner::Size() const {
+	return names.size();
+}
@@ -0,0 +1,30 @@
+#ifndef INTERNER_HPP
+#define INTERNER_HPP
+
+#include "globals.hpp"
+#include "flat_map.hpp"
+
+#include <deque>
+
+// maps each distinct identifier to a dense id (0, 1, 2, ... in order of first appearance).
+// names are hashed once, when they are lexed; everything after that compares ids.
+class Interner {
+public:
+	Interner() = default;
+	Interner(const Interner& other);
+	Interner(Interner&& other) noexcept = default;
+	Interner& operator=(const Interner& other);
+	Interner& operator=(Interner&& other) noexcept = default;
+
+	SymbolId Intern(std::string_view name);
+	std::optional<SymbolId> Find(std::string_view name) const;
+	std::string_view GetName(SymbolId id) const;
+	size_t Size() const;
+private:
+	// names own the text (a deque never relocates its elements), so ids outlive the source they were lexed from.
+	// the map's keys view into names.
+	std::deque<std::string> names{};
+	FlatMap<std::string_view, SymbolId> ids{};
+};
+
+#endif
@@ -1,170 +1,260 @@
 #include "lexer.hpp"
+#include "scanner.hpp"
 
 #include <charconv>
 #include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+#include <exception>
+#include <thread>
 #include <cassert>
 
-std::vector<Token> Lexer::GenerateTokens(std::string_view input_string) {
-	std::vector<Token> tokens{};
-	//int curr_indent_num = 0;
-	
-	auto IsEndOfFile = [&input_string](const auto iter) {return iter == std::end(input_string) || *iter == '\0'; };
-	auto IsEndOfLine = [&](const auto iter) {return IsEndOfFile(iter) || *iter == '\n'; };
-	auto IsStartOfNewLine = [&]() {return tokens.empty() || tokens.back().category == Category::Newline; };
-	int indent_level = 0;
+namespace {
+	constexpr bool IsTokenBoundary(CharClass char_class) {
+		// true if the class ends an identifier or numeric literal (and begins a new token or line)
+		switch (char_class) {
+		case CharClass::EndOfFile:
+		case CharClass::Newline:
+		case CharClass::Whitespace:
+		case CharClass::Quote:
+		case CharClass::NumberSign:
+		case CharClass::LeftParenthesis:
+		case CharClass::RightParenthesis:
+		case CharClass::Colon:
+		case CharClass::Comma:
+		case CharClass::RelationalOrAssignmentOperator:
+		case CharClass::ArithmeticOperator:
+			return true;
+		case CharClass::Invalid:
+		case CharClass::Digit:
+		case CharClass::Letter:
+			return false;
+		}
+		return false;
+	}
 
-	for (auto curr_char = std::begin(input_string); !IsEndOfFile(curr_char);) {
-		Token new_token{};
+	constexpr std::array<bool, 256> MakeBoundaryTable() {
+		std::array<bool, 256> table{};
+		for (size_t c = 0; c < table.size(); ++c) {
+			table[c] = IsTokenBoundary(Utilities::char_class_table[c]);
+		}
+		return table;
+	}
+
+	constexpr std::array<bool, 256> boundary_table = MakeBoundaryTable();
+
+	constexpr bool IsBoundary(char c) {
+		return boundary_table[static_cast<unsigned char>(c)];
+	}
+}
+
+Lexer::Lexer(std::string_view input_string, Interner* _interner) :
+	begin(input_string.data()), curr_char(begin), end(begin + input_string.size()), token_start(begin), line_start(begin), interner(_interner) {}
+
+std::optional<Token> Lexer::NextToken() {
+	auto IsEndOfFile = [this](const char* iter) {return iter == end || *iter == '\0'; };
+	auto IsEndOfLine = [this](const char* iter) {return iter == end || *iter == '\0' || *iter == '\n'; };
+	auto GetView = [](const char* first, const char* last) {return std::string_view(first, last - first); };
+
+	while (true) {
+		token_start = curr_char;
+		// indents and dedents owed from the last line start are handed out one per call
+		if (pending_indents != 0) {
+			Token new_indent_token{};
+			if (pending_indents > 0) {
+				new_indent_token.category = Category::Indent;
+				--pending_indents;
+			}
+			else {
+				new_indent_token.category = Category::Dedent;
+				++pending_indents;
+			}
+			return new_indent_token;
+		}
+		if (IsEndOfFile(curr_char)) {
+			return {};
+		}
 
 		// check indentation
-		if (IsStartOfNewLine()) {
+		if (is_start_of_line) {
 			// note: dedents occur *after* a newline, not before. a block expects a dedent *after statement(s)*, and a statement is defined as ending with a newline (or eof).
+			is_start_of_line = false;
+			// the line count moves here rather than at the newline, so that a newline token is located on the line it ends
+			if (curr_char != begin) {
+				++line;
+			}
+			line_start = curr_char;
 			int curr_indentation = 0;
-			const auto char_start = curr_char;
-			while (!IsEndOfLine(curr_char) && Utilities::IsWhitespace(*curr_char)) {
+			while (!IsEndOfLine(curr_char) && Utilities::GetCharClass(*curr_char) == CharClass::Whitespace) {
 				++curr_indentation;
 				++curr_char;
 			}
-			for (int i = 0; i < std::abs(curr_indentation - indent_level); ++i) {
-				Token new_indent_token{};
-				if (curr_indentation > indent_level) {
-					new_indent_token.category = Category::Indent;
-				}
-				else {
-					new_indent_token.category = Category::Dedent;
-				}
-				tokens.push_back(new_indent_token);
-			}
+			pending_indents = curr_indentation - indent_level;
 			indent_level = curr_indentation;
-			if (char_start != curr_char) {
-				continue;	// stream has advanced; recheck loop condition
-			}
+			continue;	// stream may have advanced; recheck for end of file
 		}
 
-		if (std::isdigit(*curr_char)) {
+		Token new_token{};
+		switch (Utilities::GetCharClass(*curr_char)) {
+		case CharClass::Digit: {
 			// numeric literal
 			new_token.category = Category::NumericLiteral;
-				
-			auto start_char = curr_char;
-			while (!IsEndOfLine(curr_char) && !Utilities::IsNewTokenChar(*curr_char)) {
-				++curr_char;
+
+			const char* first = curr_char;
+			curr_char = Scanner::FindIdentifierEnd(curr_char, end);
+			if (curr_char != end && !IsBoundary(*curr_char)) {
+				throw std::invalid_argument("invalid numeric literal");
 			}
 
-			// convert to int
-			int new_number{};
-			size_t start_idx = start_char - std::begin(input_string);
-			size_t end_idx = start_idx + (curr_char - start_char);
-			const char* first = input_string.data() + start_idx;
-			const char* last = input_string.data() + end_idx;
+			// convert to int. ints have no limit, so literals too large for 64 bits keep their digits (to be converted on compiling).
+			int64_t new_number{};
+			const char* last = curr_char;
 			auto conversion_result = std::from_chars(first, last, new_number);
+			if (conversion_result.ec == std::errc::result_out_of_range) {
+				new_token.value = GetView(first, last);
+				break;
+			}
 			if (conversion_result.ptr != last) {
 				// we don't use std::errc::invalid_argument because it is only called if *no pattern was matched*
 				throw std::invalid_argument("invalid numeric literal");
 			}
-			if (conversion_result.ec == std::errc::result_out_of_range) {
-				throw std::out_of_range("numeric literal is out of range");
-			}
 			new_token.value = new_number;
+			break;
 		}
-		else if (std::isalpha(*curr_char) || *curr_char == '_') {
+		case CharClass::Letter: {
 			// identifier, keyword, or logical operator
 			// '_' is valid for Python. numbers are valid if they are not first char.
-			while (!IsEndOfLine(curr_char) && !Utilities::IsNewTokenChar(*curr_char)) {
-				if (!std::isalnum(*curr_char) && *curr_char != '_') {
-					throw std::invalid_argument("invalid identifier");
-				}
-				std::get<std::string>(new_token.value) += *curr_char;
-				++curr_char;
+			const char* identifier_start = curr_char;
+			curr_char = Scanner::FindIdentifierEnd(curr_char, end);
+			if (curr_char != end && !IsBoundary(*curr_char)) {
+				throw std::invalid_argument("invalid identifier");
 			}
+			const std::string_view identifier = GetView(identifier_start, curr_char);
+			new_token.value = identifier;
+			new_token.kind = Utilities::GetKeywordKind(identifier);
 
-			if (Utilities::IsNonLogicalOperatorKeyword(std::get<std::string>(new_token.value))) {
-				new_token.category = Category::Keyword;
-			}
-			else if (Utilities::IsLogicalOperatorKeyword(std::get<std::string>(new_token.value))) {
+			if (new_token.kind == TokenKind::And || new_token.kind == TokenKind::Or || new_token.kind == TokenKind::Not) {
 				new_token.category = Category::LogicalOperator;
 			}
+			else if (new_token.kind != TokenKind::None) {
+				new_token.category = Category::Keyword;
+			}
 			else {
 				new_token.category = Category::Identifier;
+				if (interner) {
+					new_token.symbol = interner->Intern(identifier);
+				}
 			}
+			break;
 		}
-		else if (*curr_char == '\'' || *curr_char == '\"') {
+		case CharClass::Quote: {
 			new_token.category = Category::StringLiteral;
-			auto open_quote = curr_char;
+			const char open_quote = *curr_char;
 			++curr_char;	// skip open quote
-			while (!IsEndOfLine(curr_char) && *curr_char != *open_quote) {
-				std::get<std::string>(new_token.value) += *curr_char;
-				++curr_char;
-			}
+			const char* literal_start = curr_char;
+			curr_char = Scanner::FindStringLiteralEnd(curr_char, end, open_quote);
 			if (IsEndOfLine(curr_char)) {
 				throw std::invalid_argument("unterminated string literal");
 			}
+			new_token.value = GetView(literal_start, curr_char);
 			++curr_char;	// skip close quote
+			break;
 		}
-		else if (*curr_char == '#') {
+		case CharClass::NumberSign: {
 			new_token.category = Category::Comment;
 			++curr_char;	// skip number sign
-			
-			const auto comment_start = curr_char;
-			while (!IsEndOfLine(curr_char)) {
-				++curr_char;
-			}
-			new_token.value = std::string{ input_string.substr(comment_start - std::begin(input_string), curr_char - comment_start)};
+
+			const char* comment_start = curr_char;
+			curr_char = Scanner::FindLineEnd(curr_char, end);
+			new_token.value = GetView(comment_start, curr_char);
+			break;
 		}
-		else if (*curr_char == '(') {
+		case CharClass::LeftParenthesis:
 			new_token.category = Category::LeftParenthesis;
 			++curr_char;
-		}
-		else if (*curr_char == ')') {
+			break;
+		case CharClass::RightParenthesis:
 			new_token.category = Category::RightParenthesis;
 			++curr_char;
-		}
-		else if (*curr_char == ':') {
+			break;
+		case CharClass::Colon:
 			new_token.category = Category::Colon;
 			++curr_char;
-		}
-		else if (*curr_char == ',') {
+			break;
+		case CharClass::Comma:
 			new_token.category = Category::Comma;
 			++curr_char;
-		}
-		else if (Utilities::IsRelationalOrAssignmentOperator(*curr_char)) {
-			new_token.value = std::string{ *curr_char };
+			break;
+		case CharClass::RelationalOrAssignmentOperator: {
+			const char* operator_start = curr_char;
 			++curr_char;
 			// second operator, if any, can only be '='
-			if (!IsEndOfLine(curr_char) && *curr_char == '=') {
-				std::get<std::string>(new_token.value) += *curr_char;
+			if (curr_char != end && *curr_char == '=') {
 				++curr_char;
 			}
-			if (std::get<std::string>(new_token.value) == "=") {
+			new_token.value = GetView(operator_start, curr_char);
+			new_token.kind = Utilities::GetOperatorKind(std::get<std::string_view>(new_token.value));
+			if (new_token.kind == TokenKind::Assign) {
 				new_token.value = "";	// erase string data (it's redundant given the enum)
 				new_token.category = Category::AssignmentOperator;
 			}
-			else if (std::get<std::string>(new_token.value) == "!") {
+			else if (new_token.kind == TokenKind::None) {
+				// only a lone '!' has no kind
 				throw std::invalid_argument("invalid \'!\' operator");
 			}
 			else {
 				new_token.category = Category::RelationalOperator;
 			}
+			break;
 		}
-		else if (Utilities::IsArithmeticOperator(*curr_char)) {
+		case CharClass::ArithmeticOperator:
 			new_token.category = Category::ArithmeticOperator;
-			new_token.value = std::string{ *curr_char };
+			new_token.value = GetView(curr_char, curr_char + 1);
+			new_token.kind = Utilities::GetOperatorKind(std::get<std::string_view>(new_token.value));
 			++curr_char;
-		}
-		else if (Utilities::IsWhitespace(*curr_char)) {
-			assert(!IsStartOfNewLine() && "discarding whitespaces occurs after indentation is assumed to be checked first");
+			break;
+		case CharClass::Whitespace:
 			++curr_char;
-			continue;	// skip insertion
-		}
-		else if (*curr_char == '\n') {
+			continue;	// not a token; keep scanning
+		case CharClass::Newline:
 			new_token.category = Category::Newline;
+			is_start_of_line = true;
 			++curr_char;
-		}
-		else {
+			break;
+		case CharClass::EndOfFile:
+			assert(false && "end of file is checked before dispatching");
+			break;
+		case CharClass::Invalid:
 			throw std::invalid_argument("invalid character");
 		}
 
-		// insert token
-		tokens.push_back(new_token);
+		return new_token;
+	}
+}
+
+size_t Lexer::GetTokenOffset() const {
+	return token_start - begin;
+}
+
+SourceLocation Lexer::GetTokenLocation() const {
+	return { line, static_cast<uint32_t>(token_start - line_start) + 1 };
+}
+
+std::string_view Lexer::GetSource() const {
+	return std::string_view(begin, end - begin);
+}
+
+int Lexer::GetIndentLevel() const {
+	return indent_level;
+}
+
+std::vector<Token> Lexer::GenerateTokens(std::string_view input_string, Interner* interner) {
+	std::vector<Token> tokens{};
+	Lexer lexer(input_string, interner);
+	while (std::optional<Token> new_token = lexer.NextToken()) {
+		tokens.push_back(*new_token);
 	}
 	
 	//// append dedents
@@ -174,4 +264,436 @@ std::vector<Token> Lexer::GenerateTokens(std::string_view input_string) {
 	//}
 
 	return tokens;
-}
\ No newline at end of file
+}
+
+/* TokenBuffer */
+
+namespace {
+	// kind codes below category_count are categories whose tokens have no kind.
+	// the rest are kinds, whose category follows from the kind.
+	constexpr size_t category_count = static_cast<size_t>(Category::Newline) + 1;	// Newline is the last category
+	constexpr size_t kind_count = static_cast<size_t>(TokenKind::Input) + 1;	// Input is the last kind
+	static_assert(category_count + kind_count <= 256, "kind codes must fit in a byte");
+
+	constexpr Category GetKindCategory(TokenKind kind) {
+		switch (kind) {
+		case TokenKind::Plus:
+		case TokenKind::Minus:
+		case TokenKind::Star:
+		case TokenKind::Slash:
+		case TokenKind::Percent:
+			return Category::ArithmeticOperator;
+		case TokenKind::Equal:
+		case TokenKind::NotEqual:
+		case TokenKind::Less:
+		case TokenKind::LessEqual:
+		case TokenKind::Greater:
+		case TokenKind::GreaterEqual:
+			return Category::RelationalOperator;
+		case TokenKind::Assign:
+			return Category::AssignmentOperator;
+		case TokenKind::And:
+		case TokenKind::Or:
+		case TokenKind::Not:
+			return Category::LogicalOperator;
+		case TokenKind::Print:
+		case TokenKind::If:
+		case TokenKind::Elif:
+		case TokenKind::Else:
+		case TokenKind::While:
+		case TokenKind::Int:
+		case TokenKind::Input:
+			return Category::Keyword;
+		case TokenKind::None:
+			break;
+		}
+		assert(false && "kindless tokens are encoded by category");
+		return Category::Identifier;
+	}
+}
+
+TokenBuffer::TokenBuffer(Lexer& lexer) : source(lexer.GetSource()) {
+	if (source.size() > std::numeric_limits<uint32_t>::max()) {
+		throw std::length_error("source is too large to index with 32-bit offsets");
+	}
+	while (std::optional<Token> new_token = lexer.NextToken()) {
+		Append(*new_token, lexer.GetTokenOffset());
+	}
+}
+
+TokenBuffer TokenBuffer::Lex(std::string_view source, Interner* interner, unsigned thread_count) {
+	// chunks smaller than this are not worth a thread
+	constexpr size_t min_chunk_size = size_t{ 1 } << 20;
+
+	if (source.size() > std::numeric_limits<uint32_t>::max()) {
+		throw std::length_error("source is too large to index with 32-bit offsets");
+	}
+	// the lexer stops at the first null, so no chunk may start past it
+	if (const void* null_char = std::memchr(source.data(), '\0', source.size())) {
+		source = source.substr(0, static_cast<const char*>(null_char) - source.data());
+	}
+	if (thread_count == 0) {
+		thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	const size_t chunk_count = std::clamp<size_t>(source.size() / min_chunk_size, 1, thread_count);
+	if (chunk_count == 1) {
+		Lexer lexer(source, interner);
+		try {
+			return TokenBuffer(lexer);
+		}
+		catch (const std::exception& ex) {
+			throw Utilities::AddContext(Utilities::LocationToString(lexer.GetTokenLocation()), ex);
+		}
+	}
+
+	// split into chunks of roughly equal size, each starting at the beginning of a line
+	std::vector<std::string_view> chunks{};
+	size_t chunk_start = 0;
+	for (size_t i = 1; i <= chunk_count && chunk_start < source.size(); ++i) {
+		size_t chunk_end = source.size();
+		if (i < chunk_count) {
+			chunk_end = source.find('\n', std::max(chunk_start, source.size() / chunk_count * i));
+			chunk_end = chunk_end == std::string_view::npos ? source.size() : chunk_end + 1;
+		}
+		chunks.push_back(source.substr(chunk_start, chunk_end - chunk_start));
+		chunk_start = chunk_end;
+	}
+
+	// each chunk is lexed as if it were a whole file: from indent level 0, with its own interner
+	struct ChunkResult {
+		std::optional<TokenBuffer> tokens{};
+		Interner interner{};
+		int indent_level = 0;	// at the end of the chunk
+		std::exception_ptr error{};
+		SourceLocation error_location{};	// relative to the chunk
+	};
+	std::vector<ChunkResult> results(chunks.size());
+	auto LexChunk = [&chunks, &results, interner](size_t i) {
+		Lexer lexer(chunks[i], interner ? &results[i].interner : nullptr);
+		try {
+			results[i].tokens.emplace(lexer);
+			results[i].indent_level = lexer.GetIndentLevel();
+		}
+		catch (...) {
+			results[i].error = std::current_exception();
+			results[i].error_location = lexer.GetTokenLocation();
+		}
+	};
+	{
+		std::vector<std::jthread> threads{};
+		for (size_t i = 1; i < chunks.size(); ++i) {
+			threads.emplace_back(LexChunk, i);
+		}
+		LexChunk(0);
+	}	// threads join here
+
+	// stitch in order, so that the first error (as the serial lexer would see it) is the one reported
+	TokenBuffer tokens(source);
+	int indent_level = 0;
+	for (const ChunkResult& result : results) {
+		if (result.error) {
+			const SourceLocation location{ static_cast<uint32_t>(tokens.line_starts.size() - 1) + result.error_location.line, result.error_location.column };
+			try {
+				std::rethrow_exception(result.error);
+			}
+			catch (const std::exception& ex) {
+				throw Utilities::AddContext(Utilities::LocationToString(location), ex);
+			}
+		}
+		tokens.AppendChunk(*result.tokens, &result.interner, interner, indent_level);
+		indent_level = result.indent_level;
+	}
+	return tokens;
+}
+
+void TokenBuffer::AppendChunk(const TokenBuffer& chunk, const Interner* chunk_interner, Interner* interner, int indent_level) {
+	// indent_level is the serial lexer's level at the end of the previous chunk
+	const uint32_t chunk_offset = static_cast<uint32_t>(chunk.source.data() - source.data());
+
+	// the chunk opens with one indent per column of its first line (as lexed from level 0).
+	// those are replaced with the indents or dedents relative to the previous chunk's last line.
+	const uint8_t indent_code = EncodeKind(Category::Indent, TokenKind::None);
+	const size_t leading_indents = std::find_if(std::begin(chunk.kind_codes), std::end(chunk.kind_codes), [indent_code](uint8_t code) {return code != indent_code; })
+		- std::begin(chunk.kind_codes);
+	const int indent_change = static_cast<int>(leading_indents) - indent_level;
+	// the serial lexer places them after the first line's indentation
+	const uint32_t indent_offset = chunk_offset + static_cast<uint32_t>(leading_indents);
+	const uint8_t change_code = EncodeKind(indent_change > 0 ? Category::Indent : Category::Dedent, TokenKind::None);
+	for (int i = 0; i < std::abs(indent_change); ++i) {
+		kind_codes.push_back(change_code);
+		offsets.push_back(indent_offset);
+		payloads.push_back(0);
+	}
+
+	// chunk ids are in order of first appearance within the chunk, so interning them in order matches the serial lexer
+	std::vector<SymbolId> symbols{};
+	if (interner) {
+		symbols.reserve(chunk_interner->Size());
+		for (SymbolId id = 0; id < chunk_interner->Size(); ++id) {
+			symbols.push_back(interner->Intern(chunk_interner->GetName(id)));
+		}
+	}
+
+	const uint8_t identifier_code = EncodeKind(Category::Identifier, TokenKind::None);
+	for (size_t i = leading_indents; i < chunk.Size(); ++i) {
+		kind_codes.push_back(chunk.kind_codes[i]);
+		offsets.push_back(chunk_offset + chunk.offsets[i]);
+		const uint32_t payload = chunk.payloads[i];
+		payloads.push_back(chunk.kind_codes[i] == identifier_code && interner ? symbols[payload] : payload);
+	}
+	for (size_t i = 1; i < chunk.line_starts.size(); ++i) {	// the chunk's first line start is already recorded
+		line_starts.push_back(chunk_offset + chunk.line_starts[i]);
+	}
+}
+
+void TokenBuffer::Append(const Token& token, size_t offset) {
+	uint32_t payload = 0;
+	if (token.category == Category::NumericLiteral) {
+		const int64_t* number = std::get_if<int64_t>(&token.value);
+		payload = number && *number >= 0 && *number < large_literal ? static_cast<uint32_t>(*number) : large_literal;
+	}
+	else if (token.category == Category::Identifier) {
+		payload = token.symbol;	// the name is found again by rescanning from the offset
+	}
+	else {
+		payload = static_cast<uint32_t>(std::get<std::string_view>(token.value).size());
+	}
+	kind_codes.push_back(EncodeKind(token.category, token.kind));
+	offsets.push_back(static_cast<uint32_t>(offset));
+	payloads.push_back(payload);
+	if (token.category == Category::Newline) {
+		line_starts.push_back(static_cast<uint32_t>(offset + 1));
+	}
+}
+
+uint8_t TokenBuffer::EncodeKind(Category category, TokenKind kind) {
+	if (kind == TokenKind::None) {
+		return static_cast<uint8_t>(category);
+	}
+	assert(GetKindCategory(kind) == category);
+	return static_cast<uint8_t>(category_count + static_cast<size_t>(kind));
+}
+
+TokenBuffer TokenBuffer::Deserialize(BinaryReader& reader, std::string_view source, size_t symbol_count) {
+	TokenBuffer buffer(source);
+	buffer.kind_codes = reader.ReadVector<uint8_t>();
+	buffer.offsets = reader.ReadVector<uint32_t>();
+	buffer.payloads = reader.ReadVector<uint32_t>();
+	buffer.line_starts = reader.ReadVector<uint32_t>();
+	// enough that reading a token never goes out of bounds
+	const size_t token_count = buffer.kind_codes.size();
+	const bool is_valid = buffer.offsets.size() == token_count && buffer.payloads.size() == token_count
+		&& !buffer.line_starts.empty() && buffer.line_starts.front() == 0
+		&& std::ranges::all_of(buffer.kind_codes, [](uint8_t code) {return code < category_count + kind_count; })
+		&& std::ranges::is_sorted(buffer.offsets) && (buffer.offsets.empty() || buffer.offsets.back() <= source.size())
+		&& std::ranges::is_sorted(buffer.line_starts) && buffer.line_starts.back() <= source.size();
+	if (!is_valid) {
+		throw std::runtime_error("invalid token data");
+	}
+	for (size_t i = 0; i < token_count; ++i) {
+		if (buffer.GetCategory(i) == Category::Identifier && buffer.payloads[i] >= symbol_count) {
+			throw std::runtime_error("invalid token data");
+		}
+	}
+	return buffer;
+}
+
+void TokenBuffer::Serialize(BinaryWriter& writer) const {
+	writer.WriteVector(kind_codes);
+	writer.WriteVector(offsets);
+	writer.WriteVector(payloads);
+	writer.WriteVector(line_starts);
+}
+
+size_t TokenBuffer::Size() const {
+	return kind_codes.size();
+}
+
+Token TokenBuffer::GetToken(size_t idx) const {
+	Token token{};
+	token.category = GetCategory(idx);
+	token.kind = GetKind(idx);
+	const uint32_t offset = offsets[idx];
+	const uint32_t payload = payloads[idx];
+	switch (token.category) {
+	case Category::NumericLiteral:
+		if (payload != large_literal) {
+			token.value = static_cast<int64_t>(payload);
+			break;
+		}
+		token.value = ConvertLargeLiteral(offset);
+		break;
+	case Category::Identifier: {
+		const char* first = source.data() + offset;
+		const char* last = Scanner::FindIdentifierEnd(first, source.data() + source.size());
+		token.value = std::string_view(first, last - first);
+		token.symbol = payload;
+		break;
+	}
+	case Category::StringLiteral:
+	case Category::Comment:
+		token.value = source.substr(offset + 1, payload);	// skip the open quote or number sign
+		break;
+	case Category::Keyword:
+	case Category::AssignmentOperator:
+	case Category::ArithmeticOperator:
+	case Category::LogicalOperator:
+	case Category::RelationalOperator:
+	case Category::LeftParenthesis:
+	case Category::RightParenthesis:
+	case Category::Colon:
+	case Category::Comma:
+	case Category::Indent:
+	case Category::Dedent:
+	case Category::Newline:
+		token.value = source.substr(offset, payload);
+		break;
+	}
+	return token;
+}
+
+TokenValue TokenBuffer::ConvertLargeLiteral(uint32_t offset) const {
+	const char* first = source.data() + offset;
+	const char* last = Scanner::FindIdentifierEnd(first, source.data() + source.size());
+	int64_t number{};
+	if (std::from_chars(first, last, number).ec == std::errc::result_out_of_range) {
+		return std::string_view(first, last - first);
+	}
+	return number;
+}
+
+Category TokenBuffer::GetCategory(size_t idx) const {
+	const uint8_t code = kind_codes[idx];
+	if (code < category_count) {
+		return static_cast<Category>(code);
+	}
+	return GetKindCategory(GetKind(idx));
+}
+
+TokenKind TokenBuffer::GetKind(size_t idx) const {
+	const uint8_t code = kind_codes[idx];
+	if (code < category_count) {
+		return TokenKind::None;
+	}
+	return static_cast<TokenKind>(code - category_count);
+}
+
+uint32_t TokenBuffer::GetOffset(size_t idx) const {
+	return offsets[idx];
+}
+
+SourceLocation TokenBuffer::GetLocation(size_t idx) const {
+	const uint32_t offset = idx < Size() ? offsets[idx] : static_cast<uint32_t>(source.size());
+	// the last line start at or before the offset
+	const auto line_iter = std::prev(std::upper_bound(std::begin(line_starts), std::end(line_starts), offset));
+	const auto line = static_cast<uint32_t>(line_iter - std::begin(line_starts)) + 1;
+	return { line, offset - *line_iter + 1 };
+}
+
+size_t TokenBuffer::GetLineCount() const {
+	return line_starts.size();
+}
+
+size_t TokenBuffer::FindToken(uint32_t offset, size_t first) const {
+	return std::lower_bound(std::begin(offsets) + first, std::end(offsets), offset) - std::begin(offsets);
+}
+
+void TokenBuffer::Reserve(size_t token_count, size_t line_count) {
+	kind_codes.reserve(token_count);
+	offsets.reserve(token_count);
+	payloads.reserve(token_count);
+	line_starts.reserve(line_count);
+}
+
+int TokenBuffer::AppendBlock(const TokenBuffer& block_tokens, size_t first, size_t last, uint32_t from_offset, uint32_t to_offset, int indent_level) {
+	const uint8_t indent_code = EncodeKind(Category::Indent, TokenKind::None);
+	const uint8_t dedent_code = EncodeKind(Category::Dedent, TokenKind::None);
+	const uint8_t newline_code = EncodeKind(Category::Newline, TokenKind::None);
+
+	// the serial lexer dedents to level 0 at the start of an unindented line
+	while (first < last && block_tokens.kind_codes[first] == dedent_code) {
+		++first;
+	}
+	for (int i = 0; i < indent_level; ++i) {
+		kind_codes.push_back(dedent_code);
+		offsets.push_back(to_offset);
+		payloads.push_back(0);
+	}
+
+	kind_codes.insert(std::end(kind_codes), std::begin(block_tokens.kind_codes) + first, std::begin(block_tokens.kind_codes) + last);
+	payloads.insert(std::end(payloads), std::begin(block_tokens.payloads) + first, std::begin(block_tokens.payloads) + last);
+	int block_indent_level = 0;
+	for (size_t i = first; i < last; ++i) {
+		const uint8_t code = block_tokens.kind_codes[i];
+		const uint32_t offset = block_tokens.offsets[i] - from_offset + to_offset;
+		offsets.push_back(offset);
+		if (code == indent_code) {
+			++block_indent_level;
+		}
+		else if (code == dedent_code) {
+			--block_indent_level;
+		}
+		else if (code == newline_code) {
+			line_starts.push_back(offset + 1);
+		}
+	}
+	return block_indent_level;
+}
+
+/* TokenStream */
+
+bool TokenStream::Fill(size_t count) {
+	// pull from the lexer (or buffer) until the lookahead window holds count tokens. returns false if the input ran out first.
+	assert(lexer || buffer);
+	while (lookahead_buffer.size() < count) {
+		if (buffer) {
+			if (token_idx >= buffer->Size()) {
+				return false;
+			}
+			lookahead_buffer.push_back(buffer->GetToken(token_idx++));
+			continue;
+		}
+		std::optional<Token> new_token = lexer->NextToken();
+		if (!new_token) {
+			return false;
+		}
+		lookahead_buffer.push_back(*new_token);
+	}
+	return true;
+}
+
+bool TokenStream::IsAtEnd(size_t lookahead) {
+	if (tokens) {
+		return token_idx + lookahead >= tokens->size();
+	}
+	return !Fill(lookahead + 1);
+}
+
+const Token& TokenStream::Peek(size_t lookahead) {
+	if (tokens) {
+		assert(token_idx + lookahead < tokens->size());
+		return (*tokens)[token_idx + lookahead];
+	}
+	[[maybe_unused]] const bool is_filled = Fill(lookahead + 1);
+	assert(is_filled && "peeked past the end of the stream");
+	return lookahead_buffer[lookahead];
+}
+
+std::optional<SourceLocation> TokenStream::GetLocation() const {
+	if (!buffer) {
+		return {};
+	}
+	return buffer->GetLocation(token_idx - lookahead_buffer.size());
+}
+
+void TokenStream::Advance() {
+	if (IsAtEnd()) {
+		return;
+	}
+	if (tokens) {
+		++token_idx;
+	}
+	else {
+		lookahead_buffer.pop_front();
+	}
+}
@@ -2,10 +2,117 @@
 #define LEXER_HPP
 
 #include "globals.hpp"
+#include "interner.hpp"
+#include "serialization.hpp"
 
+#include <deque>
+#include <type_traits>
+
+// lexing is pull-based: each NextToken call scans just enough input for one token.
+// tokens view into the input string, so it must outlive them (and the lexer).
+// given an interner, identifiers are interned as they are lexed and tokens carry their ids.
 class Lexer {
 public:
-	static std::vector<Token> GenerateTokens(std::string_view input_string);
+	explicit Lexer(std::string_view input_string, Interner* _interner = nullptr);
+	// lexing a temporary string would leave every token dangling
+	template <typename T> requires std::is_same_v<T, std::string>
+	explicit Lexer(T&& input_string, Interner* _interner = nullptr) = delete;
+
+	// returns nothing once the input is exhausted
+	std::optional<Token> NextToken();
+	// where the token last returned (or the one that failed to lex) begins
+	size_t GetTokenOffset() const;
+	SourceLocation GetTokenLocation() const;
+	std::string_view GetSource() const;
+	int GetIndentLevel() const;	// of the line being lexed
+
+	static std::vector<Token> GenerateTokens(std::string_view input_string, Interner* interner = nullptr);
+	template <typename T> requires std::is_same_v<T, std::string>
+	static std::vector<Token> GenerateTokens(T&& input_string, Interner* interner = nullptr) = delete;
+private:
+	const char* begin;
+	const char* curr_char;
+	const char* end;
+	const char* token_start;
+	const char* line_start;
+	uint32_t line = 1;
+	Interner* interner{};
+	int indent_level = 0;
+	int pending_indents = 0;	// indents (positive) or dedents (negative) not yet returned
+	bool is_start_of_line = true;
+};
+
+// lexed tokens stored by column: a one-byte kind code, a 32-bit source offset, and a 32-bit payload per token.
+// the payload is the value of a numeric literal (unless it is too large, see large_literal), the symbol of an identifier,
+// or the text length of anything else.
+// text is not copied; it is recovered from the source, which must outlive the buffer.
+// line starts are recorded as newlines are lexed, so any token can be located without storing lines per token.
+class TokenBuffer {
+public:
+	explicit TokenBuffer(Lexer& lexer);	// drains the lexer
+	// lexes large sources in chunks split at line starts, one chunk per thread (0 threads means one per core).
+	// the result is identical to lexing serially, including interned ids. errors are given the location they occurred at.
+	// serial by default, as chunks have not been measured faster than one thread (see the lex benchmark).
+	static TokenBuffer Lex(std::string_view source, Interner* interner = nullptr, unsigned thread_count = 1);
+	// an empty buffer over source, to be filled one block at a time with AppendBlock
+	explicit TokenBuffer(std::string_view _source) : source(_source) {}
+	// the buffer as written by Serialize, over the source it was lexed from, with an interner of symbol_count names.
+	// the source is checked only loosely (offsets must be within it).
+	static TokenBuffer Deserialize(BinaryReader& reader, std::string_view source, size_t symbol_count);
+	void Serialize(BinaryWriter& writer) const;
+
+	size_t Size() const;
+	Token GetToken(size_t idx) const;
+	Category GetCategory(size_t idx) const;
+	TokenKind GetKind(size_t idx) const;
+	uint32_t GetOffset(size_t idx) const;
+	SourceLocation GetLocation(size_t idx) const;	// idx may be Size(), the end of the source
+	size_t GetLineCount() const;
+	size_t FindToken(uint32_t offset, size_t first = 0) const;	// the first token at or after offset, searching from first
+	void Reserve(size_t token_count, size_t line_count);
+
+	// appends tokens [first, last) of a block of lines lexed in another buffer, moving the block from from_offset there to to_offset here.
+	// blocks must be appended in source order, and each must begin with an unindented line.
+	// the dedents a block starts with are replaced with indent_level dedents (the level the previous block ended at).
+	// identifiers must have been interned with the same interner (or one it was copied to).
+	// returns the indent level at the end of the block.
+	int AppendBlock(const TokenBuffer& block_tokens, size_t first, size_t last, uint32_t from_offset, uint32_t to_offset, int indent_level);
+private:
+	// the payload of a numeric literal too large for it, which is converted again from the source when it is read
+	static constexpr uint32_t large_literal = uint32_t{ 1 } << 31;
+
+	std::string_view source;
+	std::vector<uint8_t> kind_codes{};
+	std::vector<uint32_t> offsets{};
+	std::vector<uint32_t> payloads{};
+	std::vector<uint32_t> line_starts{ 0 };
+
+	void Append(const Token& token, size_t offset);
+	void AppendChunk(const TokenBuffer& chunk, const Interner* chunk_interner, Interner* interner, int indent_level);
+	static uint8_t EncodeKind(Category category, TokenKind kind);
+	TokenValue ConvertLargeLiteral(uint32_t offset) const;
+};
+
+// the parser's view of its input: an already generated vector or token buffer, or a lexer that is pulled from on demand.
+// when reading from a lexer, only the lookahead window is buffered, so the full token vector is never materialized.
+class TokenStream {
+public:
+	explicit TokenStream(const std::vector<Token>& _tokens) : tokens(&_tokens) {}
+	explicit TokenStream(const TokenBuffer& _buffer) : buffer(&_buffer) {}
+	explicit TokenStream(Lexer& _lexer) : lexer(&_lexer) {}
+
+	bool IsAtEnd(size_t lookahead = 0);
+	const Token& Peek(size_t lookahead = 0);	// must not be at end
+	void Advance();
+	std::optional<SourceLocation> GetLocation() const;	// of the next token. only known when reading from a buffer.
+private:
+	const std::vector<Token>* tokens{};
+	size_t token_idx = 0;	// for a buffer, the next token to be pulled into the lookahead window
+	const TokenBuffer* buffer{};
+	Lexer* lexer{};
+	std::deque<Token> lookahead_buffer{};
+
+	bool Fill(size_t count);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -36,9 +36,10 @@ int main()
 				//		while input
 				//			grab more lines
 				//	run
-				// 
-				//	int expression_value = expression_evaluator.evaluate(input_tokens);
-				//	std::cout << expression_value << std::endl;
+				std::optional<Value> value = command_handler.RunLine(input_line);
+				if (value) {
+					std::cout << *value << std::endl;
+				}
 			}
 		}
 		catch (const std::exception& ex) {
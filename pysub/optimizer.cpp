@@ -0,0 +1,274 @@
+#include "optimizer.hpp"
+#include "arithmetic.hpp"
+
+#include <optional>
+
+namespace {
+	// literals too large for 64 bits are not folded
+	std::optional<int64_t> GetLiteral(const Expression* expression) {
+		if (expression->kind != NodeKind::Atom) {
+			return std::nullopt;
+		}
+		const Token& value = static_cast<const Atom*>(expression)->value;
+		if (value.category != Category::NumericLiteral || !std::holds_alternative<int64_t>(value.value)) {
+			return std::nullopt;
+		}
+		return std::get<int64_t>(value.value);
+	}
+
+	bool IsUnary(const Expression* expression, TokenKind op) {
+		return expression->kind == NodeKind::UnaryExpression && static_cast<const UnaryExpression*>(expression)->op.kind == op;
+	}
+
+	std::optional<Value> Evaluate(TokenKind op, const Value& left, const Value& right) {
+		switch (op) {
+		case TokenKind::Plus:
+			return Arithmetic::Add(left, right);
+		case TokenKind::Minus:
+			return Arithmetic::Subtract(left, right);
+		case TokenKind::Star:
+			return Arithmetic::Multiply(left, right);
+		case TokenKind::Slash:
+			return Arithmetic::Divide(left, right);
+		case TokenKind::Percent:
+			return Arithmetic::Modulo(left, right);
+		case TokenKind::Equal:
+			return Arithmetic::Compare(left, right) == 0;
+		case TokenKind::NotEqual:
+			return Arithmetic::Compare(left, right) != 0;
+		case TokenKind::Less:
+			return Arithmetic::Compare(left, right) < 0;
+		case TokenKind::LessEqual:
+			return Arithmetic::Compare(left, right) <= 0;
+		case TokenKind::Greater:
+			return Arithmetic::Compare(left, right) > 0;
+		case TokenKind::GreaterEqual:
+			return Arithmetic::Compare(left, right) >= 0;
+		default:
+			return std::nullopt;
+		}
+	}
+
+	// evaluates an operator on literals, or returns nothing if that raises an error (which is left for run time).
+	// results that are not small ints are also left for run time (a literal holds at most 64 bits).
+	std::optional<int64_t> Fold(TokenKind op, int64_t left, int64_t right) {
+		try {
+			const std::optional<Value> result = Evaluate(op, left, right);
+			if (!result || !result->IsSmallInt()) {
+				return std::nullopt;
+			}
+			return result->GetSmallInt();
+		}
+		catch (const std::exception&) {
+			return std::nullopt;
+		}
+	}
+}
+
+size_t Optimizer::Optimize() {
+	const size_t nodes_before = CountNodes(tree);
+	for (Statement*& statement : tree.statements) {
+		if (statement->kind == NodeKind::Assignment) {
+			Optimize(static_cast<Assignment*>(statement)->value);
+		}
+		else {
+			Expression* root = static_cast<Expression*>(statement);
+			Optimize(root);
+			statement = root;
+		}
+	}
+	return nodes_before - CountNodes(tree);
+}
+
+void Optimizer::Optimize(Expression*& root) {
+	frames.push_back({ .slot = &root, .is_comparison_left = false });
+	while (!frames.empty()) {
+		Frame& frame = frames.back();
+		Expression* expression = *frame.slot;
+		if (frame.visited) {
+			const Frame done = frame;
+			frames.pop_back();
+			*done.slot = OptimizeNode(done);
+			continue;
+		}
+		frame.visited = true;
+		switch (expression->kind) {
+		case NodeKind::BinaryExpression: {
+			BinaryExpression* binary_expression = static_cast<BinaryExpression*>(expression);
+			const bool is_comparison = Utilities::IsComparison(binary_expression->op.kind);
+			frame.left_was_comparison = is_comparison && binary_expression->left->kind == NodeKind::BinaryExpression
+				&& Utilities::IsComparison(static_cast<const BinaryExpression*>(binary_expression->left)->op.kind);
+			frames.push_back({ .slot = &binary_expression->right, .is_comparison_left = false });
+			frames.push_back({ .slot = &binary_expression->left, .is_comparison_left = is_comparison });
+			break;
+		}
+		case NodeKind::UnaryExpression:
+			frames.push_back({ .slot = &static_cast<UnaryExpression*>(expression)->expression, .is_comparison_left = false });
+			break;
+		case NodeKind::Grouping:
+			frames.push_back({ .slot = &static_cast<Grouping*>(expression)->expression, .is_comparison_left = false });
+			break;
+		case NodeKind::Atom:
+			break;
+		case NodeKind::Assignment:
+			assert(false);	// assignments are statements, not expressions
+			break;
+		}
+	}
+}
+
+Expression* Optimizer::OptimizeNode(const Frame& frame) {
+	// the expression's children are already optimized
+	Expression* expression = *frame.slot;
+	switch (expression->kind) {
+	case NodeKind::BinaryExpression: {
+		BinaryExpression* binary_expression = static_cast<BinaryExpression*>(expression);
+		return Utilities::IsComparison(binary_expression->op.kind) ? OptimizeComparison(binary_expression, frame) : OptimizeBinary(binary_expression);
+	}
+	case NodeKind::UnaryExpression:
+		return OptimizeUnary(static_cast<UnaryExpression*>(expression));
+	case NodeKind::Grouping: {
+		Grouping* grouping = static_cast<Grouping*>(expression);
+		const Expression* inner = grouping->expression;
+		const bool stops_chain = frame.is_comparison_left && inner->kind == NodeKind::BinaryExpression
+			&& Utilities::IsComparison(static_cast<const BinaryExpression*>(inner)->op.kind);
+		return stops_chain ? grouping : grouping->expression;
+	}
+	case NodeKind::Atom:
+		return expression;
+	case NodeKind::Assignment:
+		assert(false);	// assignments are statements, not expressions
+		break;
+	}
+	return expression;
+}
+
+Expression* Optimizer::OptimizeBinary(BinaryExpression* binary_expression) {
+	const TokenKind op = binary_expression->op.kind;
+	const std::optional<int64_t> left = GetLiteral(binary_expression->left);
+
+	// the left operand decides whether the right one is evaluated, and 'and' and 'or' give the operand that decided
+	if (op == TokenKind::And || op == TokenKind::Or) {
+		if (left) {
+			const bool gives_left = op == TokenKind::And ? *left == 0 : *left != 0;
+			return gives_left ? binary_expression->left : binary_expression->right;
+		}
+		return binary_expression;
+	}
+
+	const std::optional<int64_t> right = GetLiteral(binary_expression->right);
+	if (left && right) {
+		if (const std::optional<int64_t> value = Fold(op, *left, *right)) {
+			return MakeLiteral(*value);
+		}
+		return binary_expression;
+	}
+	// identities, with the literal on either side
+	if (right && ((*right == 0 && (op == TokenKind::Plus || op == TokenKind::Minus))
+		|| (*right == 1 && (op == TokenKind::Star || op == TokenKind::Slash)))) {
+		return binary_expression->left;
+	}
+	if (left && ((*left == 0 && op == TokenKind::Plus) || (*left == 1 && op == TokenKind::Star))) {
+		return binary_expression->right;
+	}
+	return binary_expression;
+}
+
+Expression* Optimizer::OptimizeComparison(BinaryExpression* comparison, const Frame& frame) {
+	// a chain ("a < b < c") is a left-leaning tree of comparisons, where only the operands can be optimized on their own
+	Expression*& left = comparison->left;
+	if (!frame.left_was_comparison && left->kind == NodeKind::BinaryExpression
+		&& Utilities::IsComparison(static_cast<const BinaryExpression*>(left)->op.kind)) {
+		// a comparison that was grouped (and has lost the grouping to another rewrite, e.g. "(a < b) * 1") must not join the chain
+		left = tree.arena.Make<Grouping>(left);
+	}
+	if (frame.is_comparison_left) {
+		return comparison;	// a link of a chain is folded with the rest of it
+	}
+
+	std::vector<BinaryExpression*> chain{ comparison };
+	while (chain.back()->left->kind == NodeKind::BinaryExpression
+		&& Utilities::IsComparison(static_cast<const BinaryExpression*>(chain.back()->left)->op.kind)) {
+		chain.push_back(static_cast<BinaryExpression*>(chain.back()->left));
+	}
+	bool all_literals = GetLiteral(chain.back()->left).has_value();
+	for (const BinaryExpression* link : chain) {
+		all_literals = all_literals && GetLiteral(link->right);
+	}
+	if (!all_literals) {
+		return comparison;
+	}
+
+	int64_t left_value = *GetLiteral(chain.back()->left);
+	for (auto iter = std::rbegin(chain); iter != std::rend(chain); ++iter) {
+		const int64_t right_value = *GetLiteral((*iter)->right);
+		if (!*Fold((*iter)->op.kind, left_value, right_value)) {
+			return MakeLiteral(0);
+		}
+		left_value = right_value;
+	}
+	return MakeLiteral(1);
+}
+
+Expression* Optimizer::OptimizeUnary(UnaryExpression* unary_expression) {
+	Expression* operand = unary_expression->expression;
+	const std::optional<int64_t> value = GetLiteral(operand);
+	switch (unary_expression->op.kind) {
+	case TokenKind::Plus:
+		return operand;
+	case TokenKind::Minus:
+		if (value) {
+			if (const std::optional<int64_t> negated = Fold(TokenKind::Minus, 0, *value)) {
+				return MakeLiteral(*negated);
+			}
+			return unary_expression;
+		}
+		if (IsUnary(operand, TokenKind::Minus)) {
+			return static_cast<UnaryExpression*>(operand)->expression;
+		}
+		return unary_expression;
+	case TokenKind::Not:
+		if (value) {
+			return MakeLiteral(!*value);
+		}
+		if (IsUnary(operand, TokenKind::Not) && IsUnary(static_cast<UnaryExpression*>(operand)->expression, TokenKind::Not)) {
+			return static_cast<UnaryExpression*>(operand)->expression;
+		}
+		return unary_expression;
+	default:
+		throw std::invalid_argument("invalid unary operator");
+	}
+}
+
+Atom* Optimizer::MakeLiteral(int64_t value) {
+	return tree.arena.Make<Atom>(Token{ .value = value, .category = Category::NumericLiteral });
+}
+
+size_t Optimizer::CountNodes(const AST& counted) {
+	// with an explicit stack, as trees can be deeper than the native stack allows
+	size_t count = 0;
+	std::vector<const Statement*> stack(std::begin(counted.statements), std::end(counted.statements));
+	while (!stack.empty()) {
+		const Statement* node = stack.back();
+		stack.pop_back();
+		++count;
+		switch (node->kind) {
+		case NodeKind::BinaryExpression:
+			stack.push_back(static_cast<const BinaryExpression*>(node)->left);
+			stack.push_back(static_cast<const BinaryExpression*>(node)->right);
+			break;
+		case NodeKind::UnaryExpression:
+			stack.push_back(static_cast<const UnaryExpression*>(node)->expression);
+			break;
+		case NodeKind::Grouping:
+			stack.push_back(static_cast<const Grouping*>(node)->expression);
+			break;
+		case NodeKind::Atom:
+			break;
+		case NodeKind::Assignment:
+			stack.push_back(static_cast<const Assignment*>(node)->value);
+			break;
+		}
+	}
+	return count;
+}
@@ -0,0 +1,45 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include "parser.hpp"
+
+#include <vector>
+
+// simplifies a tree in place, between parsing and compiling. a rewrite never changes what the code does, or which errors it raises:
+//	subtrees of literals are folded into one literal (unless evaluating them raises an error, which is left for run time).
+//	a comparison chain is folded as a whole, once all of its operands are literals.
+//	groupings are removed, except around a comparison that is the left operand of a comparison (where they stop it chaining).
+//	unary '+' is removed, and stacked '-' and 'not' are collapsed ("--x" is x, and "not not not x" is "not x").
+//		("not not x" is not x, but 1 or 0.) python's ints do not overflow, so "--x" is x even where our "-x" would overflow.
+//	identities that keep their operand are applied: x + 0, 0 + x, x - 0, x * 1, 1 * x, x / 1.
+//		(x * 0 is not 0, as x can still raise an error.)
+//	'and' and 'or' with a literal left operand are decided ("0 and x" is 0, and "1 and x" is x).
+// new nodes are made with the tree's arena; nodes that are cut out stay there until the tree is freed.
+// the tree is walked in post-order with an explicit stack, as trees can be deeper than the native stack allows.
+class Optimizer {
+public:
+	explicit Optimizer(AST& _tree) : tree(_tree) {}
+	// returns the number of nodes eliminated
+	size_t Optimize();
+private:
+	// an expression waiting for its children to be optimized, then to be optimized itself
+	struct Frame {
+		Expression** slot;	// where the expression is referenced from, to be replaced by its optimized form
+		bool is_comparison_left;	// whether the expression is the left operand of a comparison
+		bool left_was_comparison = false;	// whether its left operand was a comparison before optimizing (so chains with it)
+		bool visited = false;	// whether its children are on the stack
+	};
+
+	AST& tree;
+	std::vector<Frame> frames{};
+
+	void Optimize(Expression*& root);
+	Expression* OptimizeNode(const Frame& frame);
+	Expression* OptimizeBinary(BinaryExpression* binary_expression);
+	Expression* OptimizeComparison(BinaryExpression* comparison, const Frame& frame);
+	Expression* OptimizeUnary(UnaryExpression* unary_expression);
+	Atom* MakeLiteral(int64_t value);
+	static size_t CountNodes(const AST& counted);
+};
+
+#endif
@@ -1,9 +1,56 @@
 #include "parser.hpp"
 
-#include <iostream>
 #include <stdexcept>
+#include <functional>
 #include <cassert>
 
+namespace {
+	// how tightly each operator binds its operands; a higher power binds more tightly.
+	constexpr uint8_t or_power = 1;
+	constexpr uint8_t and_power = 2;
+	constexpr uint8_t not_power = 3;	// prefix
+	constexpr uint8_t comparison_power = 4;
+	constexpr uint8_t sum_power = 5;
+	constexpr uint8_t term_power = 6;
+	constexpr uint8_t sign_power = 7;	// prefix '+' and '-'
+
+	// of binary operators (0 for any other kind). every kind is listed, so adding one forces a decision here.
+	constexpr uint8_t GetBindingPower(TokenKind kind) {
+		switch (kind) {
+		case TokenKind::Or:
+			return or_power;
+		case TokenKind::And:
+			return and_power;
+		case TokenKind::Equal:
+		case TokenKind::NotEqual:
+		case TokenKind::Less:
+		case TokenKind::LessEqual:
+		case TokenKind::Greater:
+		case TokenKind::GreaterEqual:
+			return comparison_power;
+		case TokenKind::Plus:
+		case TokenKind::Minus:
+			return sum_power;
+		case TokenKind::Star:
+		case TokenKind::Slash:
+		case TokenKind::Percent:
+			return term_power;
+		case TokenKind::None:
+		case TokenKind::Assign:
+		case TokenKind::Not:
+		case TokenKind::Print:
+		case TokenKind::If:
+		case TokenKind::Elif:
+		case TokenKind::Else:
+		case TokenKind::While:
+		case TokenKind::Int:
+		case TokenKind::Input:
+			return 0;
+		}
+		return 0;
+	}
+}
+
 // return true and consume one token if curr token matches any of the inputs
 bool Parser::Match(auto&&... input) {
 	bool match_found = false;
@@ -22,38 +69,35 @@ bool Parser::Match(auto&&... input) {
 
 void Parser::IncrementToken() {
 	if (!IsAtEnd()) {
-		++curr_token;
+		previous_token = tokens.Peek();
+		tokens.Advance();
 	}
 }
 
-bool Parser::Check(std::string_view s) const {
+bool Parser::Check(Category category) {
 	if (IsAtEnd()) {
 		return false;
 	}
-	return std::get<std::string>(curr_token->value) == s;
+	return tokens.Peek().category == category;
 }
 
-bool Parser::Check(Category category) const {
+bool Parser::Check(TokenKind kind) {
 	if (IsAtEnd()) {
 		return false;
 	}
-	return curr_token->category == category;
+	return tokens.Peek().kind == kind;
 }
 
-bool Parser::Check(const Token& compare_token) const {
-	if (IsAtEnd()) {
-		return false;
-	}
-	return *curr_token == compare_token;
+bool Parser::IsAtEnd() {
+	return tokens.IsAtEnd();
 }
 
-bool Parser::IsAtEnd() const {
-	return curr_token == std::end(tokens);
+Token Parser::GetPreviousToken() const {
+	return previous_token;
 }
 
-Token Parser::GetPreviousToken() const {
-	assert(curr_token != std::begin(tokens));
-	return *(curr_token - 1);
+std::optional<SourceLocation> Parser::GetLocation() const {
+	return tokens.GetLocation();
 }
 
 [[nodiscard]] std::unique_ptr<AST> Parser::BuildTree() {
@@ -66,6 +110,7 @@ void Parser::CheckSyntax() {
 
 std::unique_ptr<AST> Parser::BuildAST() {
 	std::unique_ptr<AST> new_ast = std::make_unique<AST>();
+	arena = &new_ast->arena;
 	
 	// skip empty lines
 	while (Match(Category::Newline, Category::Comment)) {}
@@ -75,8 +120,8 @@ std::unique_ptr<AST> Parser::BuildAST() {
 	return new_ast;
 }
 
-std::vector<std::unique_ptr<Statement>> Parser::GetStatements() {
-	std::vector<std::unique_ptr<Statement>> statements{};
+std::vector<Statement*> Parser::GetStatements() {
+	std::vector<Statement*> statements{};
 	assert(!Match(Category::Newline, Category::Comment));
 	statements.push_back(GetStatement());
 	while (!IsAtEnd()) {
@@ -88,130 +133,118 @@ std::vector<std::unique_ptr<Statement>> Parser::GetStatements() {
 	return statements;
 }
 
-std::unique_ptr<Statement> Parser::GetStatement() {
-	//if (Check("if") || Check("while")) {
+Statement* Parser::GetStatement() {
+	//if (Check(TokenKind::If) || Check(TokenKind::While)) {
 	//	return GetCompoundStatement();
 	//}
-	std::unique_ptr<Statement> simple = GetSimpleStatement();
+	Statement* simple = GetSimpleStatement();
 	Match(Category::Newline);	// optional
 	return simple;
 }
 
 //CompoundStatement Parser::GetCompoundStatement() {
-//	if (Check("if")) {
+//	if (Check(TokenKind::If)) {
 //		return GetIfStatement();
 //	}
 //	return GetWhileStatement();
 //}
 
-std::unique_ptr<Statement> Parser::GetSimpleStatement() {
-	// assignment or expression (assignment omitted)
-	return GetExpression();
-}
-
-std::unique_ptr<Expression> Parser::GetExpression() {
-	std::unique_ptr<Expression> left = GetConjunction();
-	while (Match(Token{ .value = "or", .category = Category::LogicalOperator })) {
-		Token op = GetPreviousToken();
-		std::unique_ptr<Expression> right = GetConjunction();
-		left = std::make_unique<BinaryExpression>(std::move(left), op, std::move(right));
-	}
-	return left;
-}
-
-std::unique_ptr<Expression> Parser::GetConjunction() {
-	std::unique_ptr<Expression> left = GetInversion();
-	while (Match(Token{ .value = "and", .category = Category::LogicalOperator })) {
-		Token op = GetPreviousToken();
-		std::unique_ptr<Expression> right = GetInversion();
-		left = std::make_unique<BinaryExpression>(std::move(left), op, std::move(right));
-	}
-	return left;
-}
-
-std::unique_ptr<Expression> Parser::GetInversion() {
-	if (Match(Token{ .value = "not", .category = Category::LogicalOperator })) {
-		Token op = GetPreviousToken();
-		std::unique_ptr<Expression> expression = GetInversion();
-		return std::make_unique<UnaryExpression>(std::move(expression), op);
-	}
-	return GetComparison();
-}
-
-std::unique_ptr<Expression> Parser::GetComparison() {
-	std::unique_ptr<Expression> left = GetSum();
-	while (Match(Category::RelationalOperator)) {
-		Token op = GetPreviousToken();
-		std::unique_ptr<Expression> right = GetSum();
-		left = std::make_unique<BinaryExpression>(std::move(left), op, std::move(right));
-	}
-	return left;
-}
-
-std::unique_ptr<Expression> Parser::GetSum() {
-	std::unique_ptr<Expression> left = GetTerm();
-	while (Match(Token{.value = "+", .category = Category::ArithmeticOperator}, Token{.value = "-", .category = Category::ArithmeticOperator})) {
-		Token op = GetPreviousToken();
-		std::unique_ptr<Expression> right = GetTerm();
-		left = std::make_unique<BinaryExpression>(std::move(left), op, std::move(right));
-	}
-	return left;
-}
-
-std::unique_ptr<Expression> Parser::GetTerm() {
-	std::unique_ptr<Expression> left = GetFactor();
-	while (Match(
-		Token{ .value = "*", .category = Category::ArithmeticOperator },
-		Token{ .value = "/", .category = Category::ArithmeticOperator },
-		Token{ .value = "%", .category = Category::ArithmeticOperator }
-		)) {
-		Token op = GetPreviousToken();
-		std::unique_ptr<Expression> right = GetFactor();
-		left = std::make_unique<BinaryExpression>(std::move(left), op, std::move(right));
-	}
-	return left;
-}
-
-std::unique_ptr<Expression> Parser::GetFactor() {
-	if (Match(Token{ .value = "+", .category = Category::ArithmeticOperator }, Token{ .value = "-", .category = Category::ArithmeticOperator })) {
-		Token op = GetPreviousToken();
-		std::unique_ptr<Expression> expression = GetPrimary();
-		return std::make_unique<UnaryExpression>(std::move(expression), op);
+Statement* Parser::GetSimpleStatement() {
+	// assignment or expression
+	if (Check(Category::Identifier) && !tokens.IsAtEnd(1) && tokens.Peek(1).kind == TokenKind::Assign) {
+		IncrementToken();
+		const Token name = GetPreviousToken();
+		IncrementToken();
+		return arena->Make<Assignment>(name, GetExpression());
 	}
-	return GetPrimary();
+	return GetExpression();
 }
 
-std::unique_ptr<Expression> Parser::GetPrimary() {
-	// get arguments (we omit for now)
-	return GetAtom();
-}
+Expression* Parser::GetExpression() {
+	// precedence climbing, with explicit stacks instead of a function per precedence level.
+	// nothing recurses, so parentheses can nest as deeply as memory allows.
+	// each token is peeked once, and dispatched on its category or kind.
+	assert(pending_operators.empty() && operands.empty());
+	auto Reduce = [this]() {
+		const PendingOperator pending = pending_operators.back();
+		pending_operators.pop_back();
+		Expression* right = operands.back();
+		operands.pop_back();
+		if (pending.is_prefix) {
+			operands.push_back(arena->Make<UnaryExpression>(right, pending.op));
+		}
+		else {
+			operands.back() = arena->Make<BinaryExpression>(operands.back(), pending.op, right);
+		}
+	};
+	struct StackGuard {
+		// the stacks are kept between expressions (to reuse their memory), but must be left empty, even after a syntax error
+		Parser& parser;
+		~StackGuard() {
+			parser.pending_operators.clear();
+			parser.operands.clear();
+		}
+	} guard{ *this };
 
-std::unique_ptr<Expression> Parser::GetAtom() {
-	if (Match(Category::Identifier, Category::NumericLiteral)) {
-		return std::make_unique<Atom>(GetPreviousToken());
-	}
-	return GetGrouping();
-}
+	while (true) {
+		// operand: any open parentheses and prefix operators, then an atom
+		while (true) {
+			if (IsAtEnd()) {
+				throw UnexpectedEndOfFile();
+			}
+			const Token& next = tokens.Peek();
+			if (next.category == Category::Identifier || next.category == Category::NumericLiteral) {
+				operands.push_back(arena->Make<Atom>(next));
+				IncrementToken();
+				break;
+			}
+			if (next.category == Category::LeftParenthesis) {
+				pending_operators.push_back({ next, 0, false });
+			}
+			else if (next.kind == TokenKind::Plus || next.kind == TokenKind::Minus) {
+				pending_operators.push_back({ next, sign_power, true });
+			}
+			else if (next.kind == TokenKind::Not && (pending_operators.empty() || pending_operators.back().power <= not_power)) {
+				// 'not' negates an inversion, so it cannot follow an operator that binds more tightly (e.g. "1 + not 2")
+				pending_operators.push_back({ next, not_power, true });
+			}
+			else {
+				throw std::runtime_error("expected expression");
+			}
+			IncrementToken();
+		}
 
-std::unique_ptr<Expression> Parser::GetGrouping() {
-	// because this is the final rule in parsing an expression (before recursing back to the start), we perform additional checks
-	if (Match(Category::LeftParenthesis)) {
-		std::unique_ptr<Expression> expression = GetExpression();
-		if (!Match(Category::RightParenthesis)) {
-			throw std::runtime_error("expected right parenthesis after expression");
+		// binary operator, or the end of the expression or of a grouping
+		while (true) {
+			const Token* next = IsAtEnd() ? nullptr : &tokens.Peek();
+			const uint8_t power = next ? GetBindingPower(next->kind) : 0;
+			// pending operators that bind at least as tightly (binary operators are left-associative) are applied first
+			while (!pending_operators.empty() && pending_operators.back().power != 0 && pending_operators.back().power >= power) {
+				Reduce();
+			}
+			if (power != 0) {
+				pending_operators.push_back({ *next, power, false });
+				IncrementToken();
+				break;
+			}
+			if (pending_operators.empty()) {
+				assert(operands.size() == 1);
+				return operands.back();
+			}
+			if (!next || next->category != Category::RightParenthesis) {
+				throw std::runtime_error("expected right parenthesis after expression");
+			}
+			IncrementToken();
+			pending_operators.pop_back();
+			operands.back() = arena->Make<Grouping>(operands.back());
 		}
-		return std::make_unique<Grouping>(std::move(expression));
-	}
-	if (IsAtEnd()) {
-		throw UnexpectedEndOfFile();
 	}
-	throw std::runtime_error("expected expression");
 }
 
 
 //IfStatement Parser::GetIfStatement() {
 //	IfStatement new_if_statement{};
-//	if (!Match("if")) {
+//	if (!Match(TokenKind::If)) {
 //		throw std::runtime_error("\'if\' expected!");
 //	}
 //	new_if_statement.condition = GetExpression();
@@ -226,146 +259,139 @@ std::unique_ptr<Expression> Parser::GetGrouping() {
 
 /* Statement */
 
-bool Statement::operator==(const Statement& other) const {
-	if (typeid(other) != typeid(*this)) {
-		return false;
+namespace {
+	uint64_t Mix(uint64_t hash, uint64_t value) {
+		// boost's hash_combine, widened to 64 bits
+		return hash ^ (value + 0x9e3779b97f4a7c15 + (hash << 12) + (hash >> 4));
 	}
-	return BaseCaseEquals(other);
-}
-
-bool Statement::BaseCaseEquals(const Statement& other) const {
-	// "base case" for derived class calls to operator== (to prevent infinite recursion)
-	other;
-	return true;
-}
-
-/* Expression */
-
-bool Expression::operator==(const Statement& other) const {
-	if (typeid(other) != typeid(*this)) {
-		return false;
-	}
-	const Expression* other_casted = dynamic_cast<const Expression*>(&other);
-	return *this == *other_casted;
-}
-
-bool Expression::operator==(const Expression& other) const {
-	return Statement::BaseCaseEquals(other);
-}
 
-/* BinaryExpression */
-
-void BinaryExpression::Accept(const Visitor& visitor) const {
-	visitor.VisitBinaryExpression(this);
-}
-
-bool BinaryExpression::operator==(const Statement& other) const {
-	if (typeid(other) != typeid(*this)) {
-		return false;
+	uint64_t HashToken(const Token& token) {
+		// what Token::operator== compares: the category and the value
+		const uint64_t value_hash = std::visit([](const auto& v) -> uint64_t {return std::hash<std::decay_t<decltype(v)>>{}(v); }, token.value);
+		return Mix(Mix(static_cast<uint64_t>(token.category), token.value.index()), value_hash);
 	}
-	const BinaryExpression* other_casted = dynamic_cast<const BinaryExpression*>(&other);
-	return *this == *other_casted;
 }
 
-bool BinaryExpression::operator==(const BinaryExpression& other) const {
-	assert(other.left);
-	assert(other.right);
-	const Statement* left_virtual_downcast = dynamic_cast<const Statement*>(left.get());
-	const Statement* right_virtual_downcast = dynamic_cast<const Statement*>(right.get());
-	return *left_virtual_downcast == *other.left
-		&& op == other.op
-		&& *right_virtual_downcast == *other.right
-		&& Expression::operator==(other);
-}
-
-/* UnaryExpression */
-
-void UnaryExpression::Accept(const Visitor& visitor) const {
-	visitor.VisitUnaryExpression(this);
-}
-
-bool UnaryExpression::operator==(const Statement& other) const {
-	if (typeid(other) != typeid(*this)) {
-		return false;
+bool Statement::operator==(const Statement& other) const {
+	std::vector<std::pair<const Statement*, const Statement*>> stack{ {this, &other} };
+	while (!stack.empty()) {
+		auto [l, r] = stack.back();
+		stack.pop_back();
+		if (l->kind != r->kind) {
+			return false;
+		}
+		switch (l->kind) {
+		case NodeKind::BinaryExpression: {
+			const auto* l_binary = static_cast<const BinaryExpression*>(l);
+			const auto* r_binary = static_cast<const BinaryExpression*>(r);
+			if (!(l_binary->op == r_binary->op)) {
+				return false;
+			}
+			stack.emplace_back(l_binary->right, r_binary->right);
+			stack.emplace_back(l_binary->left, r_binary->left);
+			break;
+		}
+		case NodeKind::UnaryExpression: {
+			const auto* l_unary = static_cast<const UnaryExpression*>(l);
+			const auto* r_unary = static_cast<const UnaryExpression*>(r);
+			if (!(l_unary->op == r_unary->op)) {
+				return false;
+			}
+			stack.emplace_back(l_unary->expression, r_unary->expression);
+			break;
+		}
+		case NodeKind::Grouping:
+			stack.emplace_back(static_cast<const Grouping*>(l)->expression, static_cast<const Grouping*>(r)->expression);
+			break;
+		case NodeKind::Atom:
+			if (!(static_cast<const Atom*>(l)->value == static_cast<const Atom*>(r)->value)) {
+				return false;
+			}
+			break;
+		case NodeKind::Assignment: {
+			const auto* l_assignment = static_cast<const Assignment*>(l);
+			const auto* r_assignment = static_cast<const Assignment*>(r);
+			if (!(l_assignment->name == r_assignment->name)) {
+				return false;
+			}
+			stack.emplace_back(l_assignment->value, r_assignment->value);
+			break;
+		}
+		}
 	}
-	const UnaryExpression* other_casted = dynamic_cast<const UnaryExpression*>(&other);
-	return *this == *other_casted;
-}
-bool UnaryExpression::operator==(const UnaryExpression& other) const {
-	assert(other.expression);
-	const Statement* exp_virtual_downcast = dynamic_cast<const Statement*>(expression.get());
-	return *exp_virtual_downcast == *other.expression
-		&& op == other.op
-		&& Expression::operator==(other);
-}
-
-/* Grouping */
-
-void Grouping::Accept(const Visitor& visitor) const {
-	visitor.VisitGrouping(this);
+	return true;
 }
 
-bool Grouping::operator==(const Statement& other) const {
-	if (typeid(other) != typeid(*this)) {
-		return false;
+uint64_t Statement::Hash() const {
+	// hashes the nodes in pre-order. each kind has a fixed number of children, so the order alone determines the shape.
+	uint64_t hash = 0;
+	std::vector<const Statement*> stack{ this };
+	while (!stack.empty()) {
+		const Statement* statement = stack.back();
+		stack.pop_back();
+		hash = Mix(hash, static_cast<uint64_t>(statement->kind));
+		switch (statement->kind) {
+		case NodeKind::BinaryExpression: {
+			const auto* binary = static_cast<const BinaryExpression*>(statement);
+			hash = Mix(hash, HashToken(binary->op));
+			stack.push_back(binary->right);
+			stack.push_back(binary->left);
+			break;
+		}
+		case NodeKind::UnaryExpression: {
+			const auto* unary = static_cast<const UnaryExpression*>(statement);
+			hash = Mix(hash, HashToken(unary->op));
+			stack.push_back(unary->expression);
+			break;
+		}
+		case NodeKind::Grouping:
+			stack.push_back(static_cast<const Grouping*>(statement)->expression);
+			break;
+		case NodeKind::Atom:
+			hash = Mix(hash, HashToken(static_cast<const Atom*>(statement)->value));
+			break;
+		case NodeKind::Assignment: {
+			const auto* assignment = static_cast<const Assignment*>(statement);
+			hash = Mix(hash, HashToken(assignment->name));
+			stack.push_back(assignment->value);
+			break;
+		}
+		}
 	}
-	const Grouping* other_casted = dynamic_cast<const Grouping*>(&other);
-	return *this == *other_casted;
-}
-bool Grouping::operator==(const Grouping& other) const {
-	assert(other.expression);
-	const Statement* exp_virtual_downcast = dynamic_cast<const Statement*>(expression.get());
-	return *exp_virtual_downcast == *other.expression
-		&& Expression::operator==(other);
+	return hash;
 }
 
-/* Atom */
-
-void Atom::Accept(const Visitor& visitor) const {
-	visitor.VisitAtom(this);
-}
+/* TreePrinter */
 
-bool Atom::operator==(const Statement& other) const {
-	if (typeid(other) != typeid(*this)) {
-		return false;
-	}
-	const Atom* other_casted = dynamic_cast<const Atom*>(&other);
-	return *this == *other_casted;
+void TreePrinter::VisitBinaryExpression(const BinaryExpression& binary_expression) {
+	stream << "visited binary expression: ";
+	Visit(*binary_expression.left);
+	stream << std::get<std::string_view>(binary_expression.op.value) << std::endl;
+	Visit(*binary_expression.right);
+	stream << std::endl;
 }
-bool Atom::operator==(const Atom& other) const {
-	return value == other.value
-		&& Expression::operator==(other);
-}
-
-/* Visitor */
 
-void Visitor::Visit(const Expression* expression) const {
-	expression->Accept(*this);
+void TreePrinter::VisitUnaryExpression(const UnaryExpression& unary_expression) {
+	stream << "visited unary expression: ";
+	stream << std::get<std::string_view>(unary_expression.op.value) << std::endl;
+	Visit(*unary_expression.expression);
+	stream << std::endl;
 }
 
-void Visitor::VisitBinaryExpression(const BinaryExpression* binary_expression) const {
-	std::cout << "visited binary expression: ";
-	Visit(binary_expression->left.get());
-	std::cout << std::get<std::string>(binary_expression->op.value) << std::endl;
-	Visit(binary_expression->right.get());
-	std::cout << std::endl;
+void TreePrinter::VisitGrouping(const Grouping& grouping) {
+	stream << "visited grouping: " << std::endl;
+	Visit(*grouping.expression);
+	stream << std::endl;
 }
 
-void Visitor::VisitUnaryExpression(const UnaryExpression* unary_expression) const {
-	std::cout << "visited unary expression: ";
-	std::cout << std::get<std::string>(unary_expression->op.value) << std::endl;
-	Visit(unary_expression->expression.get());
-	std::cout << std::endl;
+void TreePrinter::VisitAtom(const Atom& atom) {
+	stream << "visited atom: ";
+	std::visit([this](const auto& val) {stream << val; }, atom.value.value);
+	stream << std::endl;
 }
 
-void Visitor::VisitAtom(const Atom* atom) const {
-	std::cout << "visited atom: ";
-	std::visit([&](const auto& val) {std::cout << val; }, atom->value.value);
-	std::cout << std::endl;
+void TreePrinter::VisitAssignment(const Assignment& assignment) {
+	stream << "visited assignment: " << std::get<std::string_view>(assignment.name.value) << std::endl;
+	Visit(*assignment.value);
+	stream << std::endl;
 }
-
-void Visitor::VisitGrouping(const Grouping* grouping) const {
-	std::cout << "visited grouping: " << std::endl;
-	Visit(grouping->expression.get());
-	std::cout << std::endl;
-}
\ No newline at end of file
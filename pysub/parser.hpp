@@ -2,149 +2,194 @@
 #define PARSER_HPP
 
 #include "globals.hpp"
+#include "lexer.hpp"
+#include "arena.hpp"
 
 #include <vector>
 #include <memory>
+#include <type_traits>
+#include <ostream>
+#include <stdexcept>
 #include <cassert>
 
 /*
 steps to creating a new class:
+add its NodeKind, and pass it to the base class constructor
 constructor if needed
-	any unique_ptr must be checked for not null
-	unique_ptrs must be moved (just the rules)
-override for bool operator==(const Statement&) const:
-	check the types
-	cast rhs into the same type, then compare
-define comparison function for self, that compares members: bool operator==(const T&) const
-	check members first, then call next base class's operator== to compare its own members.
-		and so on up the chain, stopping at Statement::BaseCaseEquals, which prevents a virtual dispatch back down (creating an infinite loop).
-			a downcast to Statement* is necessary to prevent C++ from overload matching a non-virtual memberwise operator== function.
-			e.g. unique_ptr<Expression> can contain BinaryExpression, but simply doing *ptr == *other_ptr means 'ptr' has static type of Expression, ...
-				...and because 'other_ptr' (BinaryExpression) is one conversion away from Expression (while Statement is two), the non-virtual memberwise compare function is selected.
-			(Statement only has a virtual operator==, so it necessarily dispatches properly).
-to make comparisons easier, assert that all unique_ptr (lhs or rhs) are not null (the former is done in constructor).
+	any child pointer must be checked for not null
+	nodes are made with the tree's arena (Arena::Make) and never deleted, so members other than child pointers must be trivially destructible
+add a case for the kind to Statement::operator== and Statement::Hash (in parser.cpp)
+	both walk the tree with an explicit stack, switching on the kind (no virtual calls, and no recursion on deep trees).
+	compare or hash the node's own members, then push its children.
+add a case for the kind to Visitor::Visit, and a Visit[Type] function to every visitor
+nodes have no virtual functions (and no vtable pointer); code that needs the concrete type switches on the kind.
 */
 
-class Visitor;
+// the concrete type of a node
+enum class NodeKind : uint8_t {
+	BinaryExpression,
+	UnaryExpression,
+	Grouping,
+	Atom,
+	Assignment,
+};
 
 class Statement {
 public:
-	virtual ~Statement() = default;
-	virtual void Accept(const Visitor& visitor) const = 0;
-	virtual bool operator==(const Statement& other) const;
+	const NodeKind kind;
+
+	// structural: the trees must have the same shape, operators, and values
+	bool operator==(const Statement& other) const;
+	// structural, so equal trees have equal hashes (wherever they are in memory)
+	uint64_t Hash() const;
 protected:
-	bool BaseCaseEquals(const Statement& other) const;
+	explicit Statement(NodeKind _kind) : kind(_kind) {}
 };
 
 class Expression : public Statement {
-public:
-	bool operator==(const Statement& other) const override;
-	bool operator==(const Expression& other) const;
+protected:
+	explicit Expression(NodeKind _kind) : Statement(_kind) {}
 };
 
 class BinaryExpression : public Expression {
 public:
-	std::unique_ptr<Expression> left;
+	Expression* left;
 	Token op;
-	std::unique_ptr<Expression> right;
+	Expression* right;
 
-	explicit BinaryExpression(std::unique_ptr<Expression>&& _left, Token _op, std::unique_ptr<Expression>&& _right) :
-		left(std::move(_left)), op(_op), right(std::move(_right)) {
+	explicit BinaryExpression(Expression* _left, Token _op, Expression* _right) :
+		Expression(NodeKind::BinaryExpression), left(_left), op(_op), right(_right) {
 		assert(left);
 		assert(right);
 	};
-	void Accept(const Visitor& visitor) const override;
-	bool operator==(const Statement& other) const override;
-	bool operator==(const BinaryExpression& other) const;
 };
 
 class UnaryExpression : public Expression {
 public:
-	std::unique_ptr<Expression> expression;
+	Expression* expression;
 	Token op;
 
-	explicit UnaryExpression(std::unique_ptr<Expression>&& _exp, Token _op) : expression(std::move(_exp)), op(_op) {
+	explicit UnaryExpression(Expression* _exp, Token _op) : Expression(NodeKind::UnaryExpression), expression(_exp), op(_op) {
 		assert(expression);
 	};
-	void Accept(const Visitor& visitor) const override;
-	bool operator==(const Statement& other) const override;
-	bool operator==(const UnaryExpression& other) const;
 };
 
 class Grouping : public Expression {
 public:
-	std::unique_ptr<Expression> expression;
+	Expression* expression;
 
-	explicit Grouping(std::unique_ptr<Expression>&& _exp) : expression(std::move(_exp)) {
+	explicit Grouping(Expression* _exp) : Expression(NodeKind::Grouping), expression(_exp) {
 		assert(expression);
 	};
-	void Accept(const Visitor& visitor) const override;
-	bool operator==(const Statement& other) const override;
-	bool operator==(const Grouping& other) const;
 };
 
 class Atom : public Expression {
 public:
-	Token value;
+	Token value;	// identifiers are looked up by value.symbol, never by name
 
-	explicit Atom(const Token& token) : value(token) {};
-	void Accept(const Visitor& visitor) const override;
-	bool operator==(const Statement& other) const override;
-	bool operator==(const Atom& other) const;
+	explicit Atom(const Token& token) : Expression(NodeKind::Atom), value(token) {};
+};
+
+class Assignment : public Statement {
+public:
+	Token name;
+	Expression* value;
+
+	explicit Assignment(const Token& _name, Expression* _value) : Statement(NodeKind::Assignment), name(_name), value(_value) {
+		assert(value);
+	};
 };
 
+static_assert(std::is_trivially_destructible_v<Token>, "nodes are freed with their arena, without running destructors");
+
+// the nodes are owned by the arena, and are all freed with the tree
 struct AST {
-	std::vector<std::unique_ptr<Statement>> statements{};
+	Arena arena{};
+	std::vector<Statement*> statements{};
 };
 
 // credit to Robert Nystrom's "Crafting Interpreters" book for the basic structure:
 // https://craftinginterpreters.com/
 class Parser {
 public:
-	explicit Parser(const std::vector<Token>& _tokens) : tokens(_tokens){
-		curr_token = std::cbegin(tokens);
-	}
+	explicit Parser(const std::vector<Token>& _tokens) : tokens(_tokens) {}
+	explicit Parser(const TokenBuffer& buffer) : tokens(buffer) {}
+	// tokens are lexed as the parser asks for them
+	explicit Parser(Lexer& lexer) : tokens(lexer) {}
 	[[nodiscard]] std::unique_ptr<AST> BuildTree();
 	void CheckSyntax();
+	// of the next unparsed token (e.g. after a syntax error). only known when parsing a token buffer.
+	std::optional<SourceLocation> GetLocation() const;
 
 private:
-	const std::vector<Token>& tokens;
-	std::vector<Token>::const_iterator curr_token;
+	TokenStream tokens;
+	Token previous_token{};
+	Arena* arena = nullptr;	// of the tree being built
+
+	// the stacks of GetExpression
+	struct PendingOperator {
+		Token op;
+		uint8_t power;	// binding power, or 0 for an open parenthesis
+		bool is_prefix;
+	};
+	std::vector<PendingOperator> pending_operators{};
+	std::vector<Expression*> operands{};
 
 	std::unique_ptr<AST> BuildAST();
-	std::vector<std::unique_ptr<Statement>> GetStatements();
-	std::unique_ptr<Statement> GetStatement();
+	std::vector<Statement*> GetStatements();
+	Statement* GetStatement();
 	//std::unique_ptr<CompoundStatement> GetCompoundStatement();
-	std::unique_ptr<Statement> GetSimpleStatement();
-	std::unique_ptr<Expression> GetExpression();
-	std::unique_ptr<Expression> GetConjunction();
-	std::unique_ptr<Expression> GetInversion();
-	std::unique_ptr<Expression> GetComparison();
-	std::unique_ptr<Expression> GetSum();
-	std::unique_ptr<Expression> GetTerm();
-	std::unique_ptr<Expression> GetFactor();
-	std::unique_ptr<Expression> GetPrimary();
-	std::unique_ptr<Expression> GetAtom();
-	std::unique_ptr<Expression> GetGrouping();
+	Statement* GetSimpleStatement();
+	Expression* GetExpression();
 	/*IfStatement GetIfStatement();
 	WhileStatement GetWhileStatement();*/
 
 	bool Match(auto&&... input);
 	void IncrementToken();
-	bool Check(std::string_view s) const;
-	bool Check(Category category) const;
-	bool Check(const Token& compare_token) const;
-	bool IsAtEnd() const;
+	bool Check(Category category);
+	bool Check(TokenKind kind);
+	bool IsAtEnd();
 	Token GetPreviousToken() const;
 };
 
+// statically dispatched visitor: Derived defines a function (returning Result) for each node type,
+//	e.g. Result VisitBinaryExpression(const BinaryExpression& binary_expression), and calls Visit(node) on children to recurse.
+//	a missing function is a compile error.
+// dispatch is a switch on the kind, which the compiler can inline into the derived visitor (no virtual calls).
+// the visitor is not const, so Derived can keep state between calls.
+// recursion follows the tree, so it suits tools such as printing; the compilers walk a FlatTree instead, which has no limit on depth.
+template <typename Derived, typename Result = void>
 class Visitor {
 public:
-	void Visit(const Expression* expression) const;
-	void VisitBinaryExpression(const BinaryExpression* binary_expression) const;
-	void VisitUnaryExpression(const UnaryExpression* unary_expression) const;
-	void VisitAtom(const Atom* atom) const;
-	void VisitGrouping(const Grouping* grouping) const;
+	Result Visit(const Statement& statement) {
+		Derived& derived = static_cast<Derived&>(*this);
+		switch (statement.kind) {
+		case NodeKind::BinaryExpression:
+			return derived.VisitBinaryExpression(static_cast<const BinaryExpression&>(statement));
+		case NodeKind::UnaryExpression:
+			return derived.VisitUnaryExpression(static_cast<const UnaryExpression&>(statement));
+		case NodeKind::Grouping:
+			return derived.VisitGrouping(static_cast<const Grouping&>(statement));
+		case NodeKind::Atom:
+			return derived.VisitAtom(static_cast<const Atom&>(statement));
+		case NodeKind::Assignment:
+			return derived.VisitAssignment(static_cast<const Assignment&>(statement));
+		}
+		throw std::invalid_argument("invalid node kind");
+	}
+};
+
+// prints each node it visits, for debugging
+class TreePrinter : public Visitor<TreePrinter> {
+public:
+	explicit TreePrinter(std::ostream& _stream) : stream(_stream) {}
+	void VisitBinaryExpression(const BinaryExpression& binary_expression);
+	void VisitUnaryExpression(const UnaryExpression& unary_expression);
+	void VisitGrouping(const Grouping& grouping);
+	void VisitAtom(const Atom& atom);
+	void VisitAssignment(const Assignment& assignment);
+private:
+	std::ostream& stream;
 };
 
 #endif
\ No newline at end of file
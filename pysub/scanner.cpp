@@ -0,0 +1,218 @@
+#include "scanner.hpp"
+#include "globals.hpp"
+
+#include <bit>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define PYSUB_X86_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// gcc and clang only emit avx2 instructions inside functions marked for it (msvc allows the intrinsics anywhere)
+#if defined(PYSUB_X86_SIMD) && (defined(__GNUC__) || defined(__clang__))
+#define PYSUB_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PYSUB_TARGET_AVX2
+#endif
+
+namespace {
+	/* scalar */
+
+	const char* FindLineEndScalar(const char* first, const char* last) {
+		while (first != last && *first != '\n' && *first != '\0') {
+			++first;
+		}
+		return first;
+	}
+
+	const char* FindStringLiteralEndScalar(const char* first, const char* last, char quote) {
+		while (first != last && *first != quote && *first != '\n' && *first != '\0') {
+			++first;
+		}
+		return first;
+	}
+
+	const char* FindIdentifierEndScalar(const char* first, const char* last) {
+		while (first != last) {
+			const CharClass char_class = Utilities::GetCharClass(*first);
+			if (char_class != CharClass::Letter && char_class != CharClass::Digit) {
+				break;
+			}
+			++first;
+		}
+		return first;
+	}
+
+#ifdef PYSUB_X86_SIMD
+	/* SSE2 (16 bytes at a time) */
+
+	const char* FindLineEndSSE2(const char* first, const char* last) {
+		const __m128i newline = _mm_set1_epi8('\n');
+		const __m128i null = _mm_setzero_si128();
+		for (; last - first >= 16; first += 16) {
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+			const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, null))));
+			if (mask != 0) {
+				return first + std::countr_zero(mask);
+			}
+		}
+		return FindLineEndScalar(first, last);
+	}
+
+	const char* FindStringLiteralEndSSE2(const char* first, const char* last, char quote) {
+		const __m128i quote_char = _mm_set1_epi8(quote);
+		const __m128i newline = _mm_set1_epi8('\n');
+		const __m128i null = _mm_setzero_si128();
+		for (; last - first >= 16; first += 16) {
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+			const __m128i line_end = _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, null));
+			const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(line_end, _mm_cmpeq_epi8(chunk, quote_char))));
+			if (mask != 0) {
+				return first + std::countr_zero(mask);
+			}
+		}
+		return FindStringLiteralEndScalar(first, last, quote);
+	}
+
+	const char* FindIdentifierEndSSE2(const char* first, const char* last) {
+		// comparisons are signed, so bytes >= 0x80 fall outside every range (as they should)
+		const __m128i case_bit = _mm_set1_epi8(0x20);
+		for (; last - first >= 16; first += 16) {
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+			const __m128i lowercase = _mm_or_si128(chunk, case_bit);
+			const __m128i is_letter = _mm_and_si128(_mm_cmpgt_epi8(lowercase, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lowercase, _mm_set1_epi8('z' + 1)));
+			const __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chunk, _mm_set1_epi8('9' + 1)));
+			const __m128i is_underscore = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'));
+			const __m128i is_identifier = _mm_or_si128(_mm_or_si128(is_letter, is_digit), is_underscore);
+			const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(is_identifier)) & 0xFFFFu;
+			if (mask != 0) {
+				return first + std::countr_zero(mask);
+			}
+		}
+		return FindIdentifierEndScalar(first, last);
+	}
+
+	/* AVX2 (32 bytes at a time) */
+
+	PYSUB_TARGET_AVX2 const char* FindLineEndAVX2(const char* first, const char* last) {
+		const __m256i newline = _mm256_set1_epi8('\n');
+		const __m256i null = _mm256_setzero_si256();
+		for (; last - first >= 32; first += 32) {
+			const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+			const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, newline), _mm256_cmpeq_epi8(chunk, null))));
+			if (mask != 0) {
+				return first + std::countr_zero(mask);
+			}
+		}
+		return FindLineEndSSE2(first, last);
+	}
+
+	PYSUB_TARGET_AVX2 const char* FindStringLiteralEndAVX2(const char* first, const char* last, char quote) {
+		const __m256i quote_char = _mm256_set1_epi8(quote);
+		const __m256i newline = _mm256_set1_epi8('\n');
+		const __m256i null = _mm256_setzero_si256();
+		for (; last - first >= 32; first += 32) {
+			const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+			const __m256i line_end = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, newline), _mm256_cmpeq_epi8(chunk, null));
+			const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(line_end, _mm256_cmpeq_epi8(chunk, quote_char))));
+			if (mask != 0) {
+				return first + std::countr_zero(mask);
+			}
+		}
+		return FindStringLiteralEndSSE2(first, last, quote);
+	}
+
+	PYSUB_TARGET_AVX2 const char* FindIdentifierEndAVX2(const char* first, const char* last) {
+		const __m256i case_bit = _mm256_set1_epi8(0x20);
+		for (; last - first >= 32; first += 32) {
+			const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+			const __m256i lowercase = _mm256_or_si256(chunk, case_bit);
+			const __m256i is_letter = _mm256_and_si256(_mm256_cmpgt_epi8(lowercase, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lowercase));
+			const __m256i is_digit = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chunk));
+			const __m256i is_underscore = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('_'));
+			const __m256i is_identifier = _mm256_or_si256(_mm256_or_si256(is_letter, is_digit), is_underscore);
+			const unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(is_identifier));
+			if (mask != 0) {
+				return first + std::countr_zero(mask);
+			}
+		}
+		return FindIdentifierEndSSE2(first, last);
+	}
+#endif
+
+	struct Implementation {
+		const char* (*find_line_end)(const char*, const char*);
+		const char* (*find_string_literal_end)(const char*, const char*, char);
+		const char* (*find_identifier_end)(const char*, const char*);
+	};
+
+	Implementation GetImplementation(SimdLevel level) {
+		switch (level) {
+#ifdef PYSUB_X86_SIMD
+		case SimdLevel::AVX2:
+			return { FindLineEndAVX2, FindStringLiteralEndAVX2, FindIdentifierEndAVX2 };
+		case SimdLevel::SSE2:
+			return { FindLineEndSSE2, FindStringLiteralEndSSE2, FindIdentifierEndSSE2 };
+#else
+		case SimdLevel::AVX2:
+		case SimdLevel::SSE2:
+#endif
+		case SimdLevel::Scalar:
+			break;
+		}
+		return { FindLineEndScalar, FindStringLiteralEndScalar, FindIdentifierEndScalar };
+	}
+
+	SimdLevel DetectSimdLevel() {
+#if !defined(PYSUB_X86_SIMD)
+		return SimdLevel::Scalar;
+#elif defined(_MSC_VER)
+		// sse2 is part of x64. avx2 also needs the os to save the ymm registers (osxsave + xcr0).
+		int info[4]{};
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return SimdLevel::SSE2;
+		}
+		__cpuid(info, 1);
+		const bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+		__cpuidex(info, 7, 0);
+		const bool has_avx2 = (info[1] & (1 << 5)) != 0;
+		return has_avx2 && os_saves_ymm ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#endif
+	}
+
+	const SimdLevel max_simd_level = DetectSimdLevel();
+	SimdLevel curr_simd_level = max_simd_level;
+	Implementation curr_implementation = GetImplementation(max_simd_level);
+}
+
+const char* Scanner::FindLineEnd(const char* first, const char* last) {
+	return curr_implementation.find_line_end(first, last);
+}
+
+const char* Scanner::FindStringLiteralEnd(const char* first, const char* last, char quote) {
+	return curr_implementation.find_string_literal_end(first, last, quote);
+}
+
+const char* Scanner::FindIdentifierEnd(const char* first, const char* last) {
+	return curr_implementation.find_identifier_end(first, last);
+}
+
+SimdLevel Scanner::GetSimdLevel() {
+	return curr_simd_level;
+}
+
+SimdLevel Scanner::GetMaxSimdLevel() {
+	return max_simd_level;
+}
+
+void Scanner::SetSimdLevel(SimdLevel level) {
+	curr_simd_level = level > max_simd_level ? max_simd_level : level;
+	curr_implementation = GetImplementation(curr_simd_level);
+}
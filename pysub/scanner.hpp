@@ -0,0 +1,29 @@
+#ifndef SCANNER_HPP
+#define SCANNER_HPP
+
+// vectorized searches used by the lexer to skip over runs of characters (comments, string literals, identifiers).
+// each function returns the first position in [first, last) that ends the run, or last if there is none.
+// the implementation is picked at runtime from what the CPU supports, falling back to plain loops.
+
+enum class SimdLevel
+{
+	Scalar,
+	SSE2,
+	AVX2
+};
+
+namespace Scanner {
+	// '\n' or '\0'
+	const char* FindLineEnd(const char* first, const char* last);
+	// the closing quote, '\n', or '\0'
+	const char* FindStringLiteralEnd(const char* first, const char* last, char quote);
+	// first char that is not a letter, digit, or '_'
+	const char* FindIdentifierEnd(const char* first, const char* last);
+
+	SimdLevel GetSimdLevel();
+	SimdLevel GetMaxSimdLevel();
+	// for tests and benchmarks. levels above GetMaxSimdLevel() are clamped.
+	void SetSimdLevel(SimdLevel level);
+};
+
+#endif
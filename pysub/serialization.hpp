@@ -0,0 +1,137 @@
+#ifndef SERIALIZATION_HPP
+#define SERIALIZATION_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <bit>
+
+// a compact binary format: values are copied byte for byte (in the machine's byte order), and vectors are prefixed by their size.
+// it is meant for caches read back on the same machine, not for exchanging files.
+class BinaryWriter {
+public:
+	template <typename T> requires std::is_trivially_copyable_v<T>
+	void Write(const T& value) {
+		bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+	template <typename T> requires std::is_trivially_copyable_v<T>
+	void WriteVector(const std::vector<T>& values) {
+		Write(static_cast<uint64_t>(values.size()));
+		bytes.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+	}
+	void WriteString(std::string_view string) {
+		Write(static_cast<uint64_t>(string.size()));
+		bytes.append(string);
+	}
+	const std::string& GetBytes() const {
+		return bytes;
+	}
+private:
+	std::string bytes{};
+};
+
+// reads what a BinaryWriter wrote, in the same order. reading past the end throws, so a truncated file is caught.
+class BinaryReader {
+public:
+	explicit BinaryReader(std::string_view _bytes) : bytes(_bytes) {}
+
+	template <typename T> requires std::is_trivially_copyable_v<T>
+	T Read() {
+		T value{};
+		std::memcpy(&value, Take(sizeof(T)).data(), sizeof(T));	// the bytes need not be aligned
+		return value;
+	}
+	template <typename T> requires std::is_trivially_copyable_v<T>
+	std::vector<T> ReadVector() {
+		const uint64_t size = Read<uint64_t>();
+		if (size > bytes.size() / sizeof(T)) {
+			throw std::runtime_error("truncated data");
+		}
+		std::vector<T> values(static_cast<size_t>(size));
+		if (!values.empty()) {
+			std::memcpy(values.data(), Take(values.size() * sizeof(T)).data(), values.size() * sizeof(T));
+		}
+		return values;
+	}
+	std::string_view ReadString() {
+		const uint64_t size = Read<uint64_t>();
+		if (size > bytes.size()) {
+			throw std::runtime_error("truncated data");
+		}
+		return Take(static_cast<size_t>(size));
+	}
+	bool IsAtEnd() const {
+		return bytes.empty();
+	}
+	// the number of bytes left to read (an upper bound on a size read, before anything is allocated for it)
+	size_t GetRemaining() const {
+		return bytes.size();
+	}
+private:
+	std::string_view bytes;	// what is left to read
+
+	std::string_view Take(size_t size) {
+		if (size > bytes.size()) {
+			throw std::runtime_error("truncated data");
+		}
+		const std::string_view taken = bytes.substr(0, size);
+		bytes.remove_prefix(size);
+		return taken;
+	}
+};
+
+// a 128-bit hash of bytes (MurmurHash3's x64_128), to key caches by their contents. two different contents share a hash by
+// accident with negligible probability (it is not meant to resist contents crafted to collide).
+struct ContentHash {
+	uint64_t low = 0;
+	uint64_t high = 0;
+
+	static ContentHash Of(std::string_view bytes) {
+		constexpr uint64_t c1 = 0x87c37b91114253d5ull;
+		constexpr uint64_t c2 = 0x4cf5ad432745937full;
+		auto MixLow = [](uint64_t k) {
+			return std::rotl(k * c1, 31) * c2;
+		};
+		auto MixHigh = [](uint64_t k) {
+			return std::rotl(k * c2, 33) * c1;
+		};
+		auto Finalize = [](uint64_t k) {
+			k = (k ^ (k >> 33)) * 0xff51afd7ed558ccdull;
+			k = (k ^ (k >> 33)) * 0xc4ceb9fe1a85ec53ull;
+			return k ^ (k >> 33);
+		};
+		uint64_t h1 = 0;
+		uint64_t h2 = 0;
+		const size_t block_count = bytes.size() / 16;
+		for (size_t i = 0; i < block_count; ++i) {
+			uint64_t k[2]{};
+			std::memcpy(k, bytes.data() + i * 16, 16);
+			h1 = (std::rotl(h1 ^ MixLow(k[0]), 27) + h2) * 5 + 0x52dce729;
+			h2 = (std::rotl(h2 ^ MixHigh(k[1]), 31) + h1) * 5 + 0x38495ab5;
+		}
+		// the last bytes, padded with zeros
+		const size_t tail_size = bytes.size() % 16;
+		if (tail_size > 0) {
+			uint64_t k[2]{};
+			std::memcpy(k, bytes.data() + block_count * 16, tail_size);
+			h2 ^= tail_size > 8 ? MixHigh(k[1]) : 0;
+			h1 ^= MixLow(k[0]);
+		}
+		h1 ^= bytes.size();
+		h2 ^= bytes.size();
+		h1 += h2;
+		h2 += h1;
+		h1 = Finalize(h1);
+		h2 = Finalize(h2);
+		h1 += h2;
+		h2 += h1;
+		return { h1, h2 };
+	}
+	bool operator==(const ContentHash&) const = default;
+};
+
+#endif
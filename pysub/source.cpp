@@ -0,0 +1,85 @@
+#include "source.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PYSUB_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SourceBuffer::SourceBuffer(const std::filesystem::path& file_path, bool is_text) {
+	if (!TryMap(file_path)) {
+		ReadBuffered(file_path, is_text);
+	}
+	if (!is_text) {
+		return;
+	}
+	// stop at the first null, as the lexer would
+	const void* null_char = std::memchr(view.data(), '\0', view.size());
+	if (null_char) {
+		view = view.substr(0, static_cast<const char*>(null_char) - view.data());
+	}
+}
+
+SourceBuffer::~SourceBuffer() {
+#ifdef PYSUB_HAS_MMAP
+	if (mapping) {
+		munmap(mapping, mapping_size);
+	}
+#endif
+}
+
+std::string_view SourceBuffer::GetView() const {
+	return view;
+}
+
+bool SourceBuffer::IsMapped() const {
+	return mapping != nullptr;
+}
+
+bool SourceBuffer::TryMap(const std::filesystem::path& file_path) {
+	// returns false (without throwing) whenever a buffered read should be attempted instead
+#ifdef PYSUB_HAS_MMAP
+	const int file_descriptor = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file_descriptor < 0) {
+		return false;
+	}
+	struct stat file_status {};
+	if (fstat(file_descriptor, &file_status) != 0 || !S_ISREG(file_status.st_mode) || file_status.st_size == 0) {
+		// pipes and special files have no fixed size to map. empty files cannot be mapped.
+		close(file_descriptor);
+		return false;
+	}
+	const size_t file_size = static_cast<size_t>(file_status.st_size);
+	void* new_mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+	close(file_descriptor);	// the mapping stays valid without the descriptor
+	if (new_mapping == MAP_FAILED) {
+		return false;
+	}
+	madvise(new_mapping, file_size, MADV_SEQUENTIAL);	// only a hint; failure is harmless
+
+	mapping = new_mapping;
+	mapping_size = file_size;
+	view = std::string_view(static_cast<const char*>(mapping), mapping_size);
+	return true;
+#else
+	file_path;
+	return false;
+#endif
+}
+
+void SourceBuffer::ReadBuffered(const std::filesystem::path& file_path, bool is_text) {
+	std::ifstream file_stream(file_path, is_text ? std::ios::in : std::ios::in | std::ios::binary);
+	if (file_stream.fail()) {
+		throw std::runtime_error("error opening file");
+	}
+	// read until the stream ends rather than trusting the file size, which pipes and special files do not have
+	buffer.assign(std::istreambuf_iterator<char>(file_stream), std::istreambuf_iterator<char>());
+	view = buffer;
+}
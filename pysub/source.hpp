@@ -0,0 +1,32 @@
+#ifndef SOURCE_HPP
+#define SOURCE_HPP
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// read-only contents of a source file.
+// regular files are memory-mapped where the platform supports it (the file must not be truncated while mapped, so contents
+// that outlive a read, as FileExecution's do, are copied out);
+// pipes, special files, and other platforms fall back to a buffered read.
+// like the lexer, text ends at the first '\0'. binary contents (e.g. a compiled cache) are read whole and unaltered.
+class SourceBuffer {
+public:
+	explicit SourceBuffer(const std::filesystem::path& file_path, bool is_text = true);
+	~SourceBuffer();
+	SourceBuffer(const SourceBuffer&) = delete;
+	SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+	std::string_view GetView() const;
+	bool IsMapped() const;
+private:
+	std::string_view view{};
+	void* mapping = nullptr;
+	size_t mapping_size = 0;
+	std::string buffer{};	// used when the file is not mapped
+
+	bool TryMap(const std::filesystem::path& file_path);
+	void ReadBuffered(const std::filesystem::path& file_path, bool is_text);
+};
+
+#endif
@@ -0,0 +1,38 @@
+#include "symbol_table.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+void SymbolTable::Grow(size_t slot_count) {
+	if (slots.size() < slot_count) {
+		slots.resize(slot_count);
+	}
+}
+
+size_t SymbolTable::GetSlotCount() const {
+	return slots.size();
+}
+
+const Value& SymbolTable::At(SymbolId slot) const {
+	const Value* value = Find(slot);
+	if (!value) {
+		throw std::out_of_range("variable is not assigned");
+	}
+	return *value;
+}
+
+size_t SymbolTable::Size() const {
+	return assigned.size();
+}
+
+const std::vector<SymbolId>& SymbolTable::GetAssigned() const {
+	return assigned;
+}
+
+bool SymbolTable::operator==(const SymbolTable& rhs) const {
+	// tables of the same names may differ in slot count, if one execution interned more names than it assigned
+	return Size() == rhs.Size() && std::ranges::all_of(assigned, [this, &rhs](SymbolId slot) {
+		const Value* rhs_value = rhs.Find(slot);
+		return rhs_value && *rhs_value == *Find(slot);
+	});
+}
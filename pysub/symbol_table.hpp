@@ -0,0 +1,49 @@
+#ifndef SYMBOL_TABLE_HPP
+#define SYMBOL_TABLE_HPP
+
+#include "globals.hpp"
+#include "value.hpp"
+
+#include <vector>
+#include <optional>
+#include <utility>
+#include <cassert>
+
+// variables, by slot. a name's slot is its id in the execution's interner, which is dense and fixed from when the name is
+// interned (as it is lexed, or resolved as the code is compiled), so running code indexes an array instead of hashing names.
+// the interner is the map from names to slots. slots are empty until their variable is assigned.
+class SymbolTable {
+public:
+	// grows the table to slot_count slots, if it has fewer (it never shrinks, so compiled code stays valid)
+	void Grow(size_t slot_count);
+	size_t GetSlotCount() const;
+	// the variable in a slot, or null if it has not been assigned
+	const Value* Find(SymbolId slot) const {
+		return slot < slots.size() && slots[slot] ? &*slots[slot] : nullptr;
+	}
+	// the slot must be within the table
+	void Assign(SymbolId slot, const Value& value) {
+		assert(slot < slots.size());
+		std::optional<Value>& variable = slots[slot];
+		if (variable) {
+			*variable = value;	// a small int over a small int is a plain copy
+			return;
+		}
+		variable.emplace(value);
+		assigned.push_back(slot);
+	}
+	// throws std::out_of_range if the slot has not been assigned
+	const Value& At(SymbolId slot) const;
+
+	// the number of variables assigned
+	size_t Size() const;
+	// the slots assigned, in the order they were first assigned (which is the order they are shown in)
+	const std::vector<SymbolId>& GetAssigned() const;
+	// the same variables with the same values, in any order
+	bool operator==(const SymbolTable& rhs) const;
+private:
+	std::vector<std::optional<Value>> slots{};
+	std::vector<SymbolId> assigned{};
+};
+
+#endif
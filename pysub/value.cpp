@@ -0,0 +1,85 @@
+#include "value.hpp"
+#include "bigint.hpp"
+
+#include <new>
+#include <limits>
+#include <cstring>
+#include <stdexcept>
+
+struct Value::BigIntObject : HeapObject {
+	BigInt integer;
+};
+
+Value::Value(const BigInt& integer) {
+	if (const std::optional<int64_t> small = integer.ToInt64(); small && IsSmall(*small)) {
+		bits = MakeSmallInt(*small);
+	}
+	else {
+		bits = MakeBigInt(integer);
+	}
+}
+
+Value::Value(std::string_view string) {
+	if (string.size() > std::numeric_limits<uint32_t>::max()) {
+		throw std::length_error("string is too long");
+	}
+	// the header and characters are one allocation
+	void* memory = ::operator new(sizeof(StringObject) + string.size());
+	StringObject* object = new (memory) StringObject{ { 1 }, static_cast<uint32_t>(string.size()) };
+	if (!string.empty()) {
+		std::memcpy(reinterpret_cast<char*>(object + 1), string.data(), string.size());
+	}
+	bits = reinterpret_cast<uintptr_t>(object) | string_tag;
+}
+
+uint64_t Value::MakeBigInt(int64_t integer) {
+	return MakeBigInt(BigInt(integer));
+}
+
+uint64_t Value::MakeBigInt(const BigInt& integer) {
+	static_assert(alignof(BigIntObject) > tag_mask);
+	return reinterpret_cast<uintptr_t>(new BigIntObject{ { 1 }, integer }) | big_int_tag;
+}
+
+const BigInt& Value::GetBigInt() const noexcept {
+	assert(IsBigInt());
+	return static_cast<const BigIntObject*>(GetHeapObject())->integer;
+}
+
+void Value::Free() noexcept {
+	if (IsBigInt()) {
+		delete static_cast<BigIntObject*>(GetHeapObject());
+		return;
+	}
+	StringObject* object = static_cast<StringObject*>(GetHeapObject());
+	object->~StringObject();
+	::operator delete(object);
+}
+
+std::string Value::ToString() const {
+	if (IsSmallInt()) {
+		return std::to_string(GetSmallInt());
+	}
+	if (IsBigInt()) {
+		return GetBigInt().ToString();
+	}
+	return std::string{ GetString() };
+}
+
+bool Value::operator==(const Value& rhs) const {
+	if (bits == rhs.bits) {
+		return true;	// the same small int, or the same heap value
+	}
+	// a big int never equals a small one, as big ints are only made for values that do not fit inline
+	if (IsBigInt() && rhs.IsBigInt()) {
+		return GetBigInt() == rhs.GetBigInt();
+	}
+	return IsString() && rhs.IsString() && GetString() == rhs.GetString();
+}
+
+std::ostream& operator<<(std::ostream& stream, const Value& value) {
+	if (value.IsString()) {
+		return stream << value.GetString();
+	}
+	return stream << value.ToString();
+}
@@ -0,0 +1,141 @@
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <atomic>
+#include <utility>
+#include <cstdint>
+#include <cassert>
+
+class BigInt;
+
+// a value of a variable: an int or a string, in 8 bytes (a std::variant<std::string, int> is 40).
+// ints of up to 63 bits are stored inline; larger ones, and strings, are kept on the heap and shared by reference counting,
+// so copying a value never allocates. (heap values are immutable.)
+// the low bits are the tag: an int is stored as (value << 1) | 1, and a heap value as a pointer to it (which is aligned),
+// with bit 1 set for a BigInt and clear for a string.
+class Value {
+public:
+	static constexpr int64_t max_small_int = (int64_t{ 1 } << 62) - 1;
+	static constexpr int64_t min_small_int = -(int64_t{ 1 } << 62);
+
+	Value() noexcept : Value(0) {}
+	Value(int64_t integer) {
+		bits = IsSmall(integer) ? MakeSmallInt(integer) : MakeBigInt(integer);
+	}
+	// kept inline if it fits
+	explicit Value(const BigInt& integer);
+	explicit Value(std::string_view string);
+	Value(const Value& other) noexcept : bits(other.bits) {
+		Retain();
+	}
+	Value(Value&& other) noexcept : bits(std::exchange(other.bits, zero_bits)) {}
+	Value& operator=(const Value& other) noexcept {
+		if (AreSmallInts(*this, other)) {
+			bits = other.bits;	// neither has references to count
+			return *this;
+		}
+		Value copy(other);
+		std::swap(bits, copy.bits);
+		return *this;
+	}
+	Value& operator=(Value&& other) noexcept {
+		if (this != &other) {
+			Release();
+			bits = std::exchange(other.bits, zero_bits);	// a moved-from value is 0
+		}
+		return *this;
+	}
+	~Value() {
+		Release();
+	}
+
+	static bool IsSmall(int64_t integer) noexcept {
+		return integer >= min_small_int && integer <= max_small_int;
+	}
+	bool IsInt() const noexcept {
+		return IsSmallInt() || IsBigInt();
+	}
+	bool IsSmallInt() const noexcept {
+		return bits & small_int_tag;
+	}
+	// both at once
+	static bool AreSmallInts(const Value& left, const Value& right) noexcept {
+		return left.bits & right.bits & small_int_tag;
+	}
+	bool IsBigInt() const noexcept {
+		return (bits & tag_mask) == big_int_tag;
+	}
+	bool IsString() const noexcept {
+		return (bits & tag_mask) == string_tag;
+	}
+	int64_t GetSmallInt() const noexcept {
+		assert(IsSmallInt());
+		return static_cast<int64_t>(bits) >> 1;
+	}
+	// the same as assigning Value(integer), without the temporary (which the compiler keeps in memory, to be released)
+	void AssignInt(int64_t integer) {
+		const uint64_t new_bits = IsSmall(integer) ? MakeSmallInt(integer) : MakeBigInt(integer);
+		Release();
+		bits = new_bits;
+	}
+	// the same for a small int, which has no references to release, so is simply overwritten
+	void AssignOverSmallInt(int64_t integer) {
+		assert(IsSmallInt());
+		bits = IsSmall(integer) ? MakeSmallInt(integer) : MakeBigInt(integer);
+	}
+	const BigInt& GetBigInt() const noexcept;
+	std::string_view GetString() const noexcept {
+		assert(IsString());
+		const StringObject* string = reinterpret_cast<const StringObject*>(static_cast<uintptr_t>(bits));
+		return std::string_view(reinterpret_cast<const char*>(string + 1), string->size);
+	}
+	std::string ToString() const;
+
+	bool operator==(const Value& rhs) const;
+	friend std::ostream& operator<<(std::ostream& stream, const Value& value);
+private:
+	// the start of every heap value
+	struct HeapObject {
+		std::atomic<uint32_t> references;
+	};
+	// followed by the string's characters
+	struct StringObject : HeapObject {
+		uint32_t size;
+	};
+	struct BigIntObject;
+
+	static constexpr uint64_t small_int_tag = 1;
+	static constexpr uint64_t big_int_tag = 2;
+	static constexpr uint64_t string_tag = 0;
+	static constexpr uint64_t tag_mask = 3;
+	static constexpr uint64_t zero_bits = small_int_tag;
+
+	uint64_t bits;
+
+	static uint64_t MakeSmallInt(int64_t integer) noexcept {
+		return (static_cast<uint64_t>(integer) << 1) | small_int_tag;
+	}
+	static uint64_t MakeBigInt(int64_t integer);
+	static uint64_t MakeBigInt(const BigInt& integer);
+	HeapObject* GetHeapObject() const noexcept {
+		return reinterpret_cast<HeapObject*>(static_cast<uintptr_t>(bits & ~tag_mask));
+	}
+	void Retain() const noexcept {
+		if (!IsSmallInt()) {
+			GetHeapObject()->references.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	void Release() noexcept {
+		if (!IsSmallInt() && GetHeapObject()->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			Free();
+		}
+	}
+	void Free() noexcept;
+};
+
+static_assert(sizeof(Value) == 8);
+
+#endif
@@ -8,6 +8,18 @@
 #include "../pysub/execution.cpp"
 #include "../pysub/globals.cpp"
 #include "../pysub/parser.cpp"
+#include "../pysub/scanner.cpp"
+#include "../pysub/source.cpp"
+#include "../pysub/interner.cpp"
+#include "../pysub/arena.cpp"
+#include "../pysub/flat_tree.cpp"
+#include "../pysub/bytecode.cpp"
+#include "../pysub/closures.cpp"
+#include "../pysub/optimizer.cpp"
+#include "../pysub/value.cpp"
+#include "../pysub/bigint.cpp"
+#include "../pysub/arithmetic.cpp"
+#include "../pysub/symbol_table.cpp"
 #include <vcpkg_installed/x64-windows/x64-windows/include/magic_enum/magic_enum.hpp>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -44,18 +56,21 @@ namespace Microsoft::VisualStudio::CppUnitTestFramework {
 		// wstringstream does not have default behavior for std::string (but it does for other primitive types).
 		// there is no non-deprecated conversion function in the std library (as of C++20), so windows api is used.
 		
-		// a null-terminated string is required to determine string length
-		int buffer_size = MultiByteToWideChar(CP_UTF8, 0, utf8_string.data(), -1, nullptr, 0);
+		// the length is passed explicitly because token views into the source are not null-terminated
+		if (utf8_string.empty()) {
+			return {};
+		}
+		const int input_size = static_cast<int>(utf8_string.size());
+		int buffer_size = MultiByteToWideChar(CP_UTF8, 0, utf8_string.data(), input_size, nullptr, 0);
 		if (!buffer_size) {
 			throw std::exception(ErrorToString(GetLastError()).c_str());
 		}
 		std::wstring converted(buffer_size, 0);
-		MultiByteToWideChar(CP_UTF8, 0, utf8_string.data(), -1, converted.data(), buffer_size);
-		converted.pop_back();	// remove null terminator added by c_str call
+		MultiByteToWideChar(CP_UTF8, 0, utf8_string.data(), input_size, converted.data(), buffer_size);
 		return converted;
 	}
 
-	std::wstringstream& operator<<(std::wstringstream& stream, const std::string& string) {
+	std::wstringstream& operator<<(std::wstringstream& stream, std::string_view string) {
 		stream << ToWString(string);
 		return stream;
 	}
@@ -92,66 +107,44 @@ namespace Microsoft::VisualStudio::CppUnitTestFramework {
 	}
 
 	std::wstringstream& operator<<(std::wstringstream& stream, const Statement* statement) {
-		const Atom* atom_ptr = dynamic_cast<const Atom*>(statement);
-		if (atom_ptr) {
-			stream << atom_ptr;
-			return stream;
-		}
-		const Grouping* grouping_ptr = dynamic_cast<const Grouping*>(statement);
-		if (grouping_ptr) {
-			stream << grouping_ptr;
-			return stream;
-		}
-		const Expression* expression_ptr = dynamic_cast<const Expression*>(statement);
-		if (expression_ptr) {
-			// the subclasses of Expression are handled elsewhere
-			stream << expression_ptr;
-			return stream;
-		}
-		throw std::invalid_argument("Statement cannot be printed!");
-	}
-
-	std::wstringstream& operator<<(std::wstringstream& stream, Atom* atom) {
-		stream << atom->value;
-		return stream;
-	}
-
-	std::wstringstream& operator<<(std::wstringstream& stream, Grouping* grouping) {
-		stream << grouping->expression;
-		return stream;
-	}
-
-	std::wstringstream& operator<<(std::wstringstream& stream, Expression* expression) {
-		UnaryExpression* unary_ptr = dynamic_cast<UnaryExpression*>(expression);
-		if (unary_ptr) {
-			stream << unary_ptr;
-			return stream;
+		switch (statement->kind) {
+		case NodeKind::BinaryExpression: {
+			const BinaryExpression* binary = static_cast<const BinaryExpression*>(statement);
+			stream << std::string{ "left: " };
+			stream << binary->left;
+			stream << ',';
+			stream << std::string{ "op: " };
+			stream << binary->op;
+			stream << ',';
+			stream << std::string{ "right: " };
+			stream << binary->right;
+			break;
+		}
+		case NodeKind::UnaryExpression: {
+			const UnaryExpression* unary = static_cast<const UnaryExpression*>(statement);
+			stream << std::string{ "exp: " };
+			stream << unary->expression;
+			stream << ',';
+			stream << std::string{ "op: " };
+			stream << unary->op;
+			break;
+		}
+		case NodeKind::Grouping:
+			stream << static_cast<const Grouping*>(statement)->expression;
+			break;
+		case NodeKind::Atom:
+			stream << static_cast<const Atom*>(statement)->value;
+			break;
+		case NodeKind::Assignment: {
+			const Assignment* assignment = static_cast<const Assignment*>(statement);
+			stream << std::string{ "name: " };
+			stream << assignment->name;
+			stream << ',';
+			stream << std::string{ "value: " };
+			stream << assignment->value;
+			break;
 		}
-		BinaryExpression* binary_ptr = dynamic_cast<BinaryExpression*>(expression);
-		if (binary_ptr) {
-			stream << binary_ptr;
 		}
-		return stream;
-	}
-
-	std::wstringstream& operator<<(std::wstringstream& stream, UnaryExpression* unary) {
-		stream << std::string{ "exp: " };
-		stream << unary->expression;
-		stream << ',';
-		stream << std::string{ "op: " };
-		stream << unary->op;
-		return stream;
-	}
-
-	std::wstringstream& operator<<(std::wstringstream& stream, BinaryExpression* binary) {
-		stream << std::string{ "left: " };
-		stream << binary->left;
-		stream << ',';
-		stream << std::string{ "op: " };
-		stream << binary->op;
-		stream << ',';
-		stream << std::string{ "right: " };
-		stream << binary->right;
 		return stream;
 	}
 
@@ -172,13 +165,9 @@ namespace Microsoft::VisualStudio::CppUnitTestFramework {
 		return ConstructWideString(token);
 	}
 
-	template<> inline std::wstring ToString<std::vector<std::unique_ptr<Statement>>>(const std::vector<std::unique_ptr<Statement>>& statements) {
+	template<> inline std::wstring ToString<std::vector<Statement*>>(const std::vector<Statement*>& statements) {
 		return ConstructWideString(statements);
 	}
-
-	template<> inline std::wstring ToString<std::unique_ptr<Statement>>(const std::unique_ptr<Statement>& statement) {
-		return ConstructWideString(statement.get());
-	}
 }
 
 namespace tests
@@ -199,25 +188,46 @@ namespace tests
 			auto func = []() {Lexer::GenerateTokens("1prince"); };
 			Assert::ExpectException<std::invalid_argument>(func);
 		}
-		TEST_METHOD(NumericLiteralOutOfRange) {
+		TEST_METHOD(NumericLiteralRange) {
 			// max
-			std::vector<Token> actual = Lexer::GenerateTokens(std::to_string(std::numeric_limits<int>::max()));
+			const std::string max_string = std::to_string(std::numeric_limits<int>::max());
+			std::vector<Token> actual = Lexer::GenerateTokens(max_string);
 			std::vector<Token> expected{ {std::numeric_limits<int>::max(), Category::NumericLiteral} };
 			Assert::AreEqual(expected, actual);
 
 			// min
 			// this is actually max + 1 (because we negative sign becomes a token)
-			actual = Lexer::GenerateTokens(std::to_string(std::numeric_limits<int>::min() + 1));
+			const std::string min_string = std::to_string(std::numeric_limits<int>::min() + 1);
+			actual = Lexer::GenerateTokens(min_string);
 			expected = { {"-", Category::ArithmeticOperator}, { std::numeric_limits<int>::max(), Category::NumericLiteral }};
 			Assert::AreEqual(expected, actual);
 
-			// above
-			auto above = []() {Lexer::GenerateTokens(std::to_string(static_cast<long>(std::numeric_limits<int>::max()) + 1) ); };
-			Assert::ExpectException<std::out_of_range>(above);
+			// ints have no limit: literals that fit in 64 bits are converted
+			const int64_t above_int = int64_t{ std::numeric_limits<int>::max() } + 1;
+			const std::string above_int_string = std::to_string(above_int);
+			actual = Lexer::GenerateTokens(above_int_string);
+			expected = { { above_int, Category::NumericLiteral } };
+			Assert::AreEqual(expected, actual);
+
+			const std::string max_int64_string = std::to_string(std::numeric_limits<int64_t>::max());
+			actual = Lexer::GenerateTokens(max_int64_string);
+			expected = { { std::numeric_limits<int64_t>::max(), Category::NumericLiteral } };
+			Assert::AreEqual(expected, actual);
 
-			// below
-			auto below = []() {Lexer::GenerateTokens(std::to_string(static_cast<long>(std::numeric_limits<int>::min()))); };
-			Assert::ExpectException<std::out_of_range>(below);
+			// and larger ones keep their digits
+			const std::string_view above_int64 = "9223372036854775808";
+			actual = Lexer::GenerateTokens(above_int64);
+			expected = { { above_int64, Category::NumericLiteral } };
+			Assert::AreEqual(expected, actual);
+
+			// a token buffer gives the same tokens, though it only stores small literals
+			const std::string_view source = "x = 2147483648 * 9223372036854775808 - 7\n";
+			TokenBuffer buffer = TokenBuffer::Lex(source);
+			actual = Lexer::GenerateTokens(source);
+			Assert::IsTrue(buffer.Size() == actual.size());
+			for (size_t i = 0; i < actual.size(); ++i) {
+				Assert::AreEqual(actual[i], buffer.GetToken(i));
+			}
 		}
 		TEST_METHOD(IdentifierValid)
 		{
@@ -245,6 +255,16 @@ namespace tests
 			actual = Lexer::GenerateTokens("and");
 			expected = { {"and", Category::LogicalOperator} };
 			Assert::AreEqual(expected, actual);
+			Assert::IsTrue(actual.front().kind == TokenKind::And);
+		}
+		TEST_METHOD(OperatorKind) {
+			std::vector<Token> actual = Lexer::GenerateTokens("+<=!=print prince");
+			Assert::IsTrue(actual.size() == 5);
+			Assert::IsTrue(actual.at(0).kind == TokenKind::Plus);
+			Assert::IsTrue(actual.at(1).kind == TokenKind::LessEqual);
+			Assert::IsTrue(actual.at(2).kind == TokenKind::NotEqual);
+			Assert::IsTrue(actual.at(3).kind == TokenKind::Print);
+			Assert::IsTrue(actual.at(4).kind == TokenKind::None);
 		}
 		TEST_METHOD(StringLiteralValid) {
 			std::vector<Token> actual = Lexer::GenerateTokens("\"lit\'eral\"");
@@ -277,6 +297,11 @@ namespace tests
 			std::vector<Token> actual = Lexer::GenerateTokens(",");
 			std::vector<Token> expected{ {"", Category::Comma} };
 			Assert::AreEqual(expected, actual);
+
+			// a comma also ends the token before it
+			actual = Lexer::GenerateTokens("a,1");
+			expected = { {"a", Category::Identifier}, {"", Category::Comma}, {1, Category::NumericLiteral} };
+			Assert::AreEqual(expected, actual);
 		}
 		TEST_METHOD(RelationalAssignmentValid) {
 			std::vector<Token> actual = Lexer::GenerateTokens("<<=>>=");
@@ -325,6 +350,11 @@ namespace tests
 			expected = { {"", Category::Indent}, {"", Category::Indent}, {"", Category::Newline}, {"", Category::Dedent}};
 			Assert::AreEqual(expected, actual);
 
+			// equal indent on consecutive statements
+			actual = Lexer::GenerateTokens("\t1\n\t2");
+			expected = { {"", Category::Indent}, {1, Category::NumericLiteral}, {"", Category::Newline}, {2, Category::NumericLiteral} };
+			Assert::AreEqual(expected, actual);
+
 			// multiple dedents
 			actual = Lexer::GenerateTokens("\t\t\n123");
 			expected = { {"", Category::Indent}, {"", Category::Indent}, {"", Category::Newline}, {"", Category::Dedent}, {"", Category::Dedent}, { 123, Category::NumericLiteral } };
@@ -341,6 +371,201 @@ namespace tests
 			};
 			Assert::AreEqual(expected, actual);
 		}
+		TEST_METHOD(StreamingValid) {
+			// pulling tokens one at a time yields the same sequence, including indents owed at a line start
+			std::string input{ "if (1+1\t == 2):\n\t\tprint(x)\n\ty" };
+			Lexer lexer(input);
+			std::vector<Token> actual{};
+			while (std::optional<Token> token = lexer.NextToken()) {
+				actual.push_back(*token);
+			}
+			Assert::AreEqual(Lexer::GenerateTokens(input), actual);
+			Assert::IsFalse(lexer.NextToken().has_value());
+		}
+		TEST_METHOD(TokensViewSource) {
+			// text payloads should point into the input rather than own a copy
+			std::string input{ "prince \"literal\" #comment" };
+			std::vector<Token> actual = Lexer::GenerateTokens(input);
+			Assert::IsTrue(actual.size() == 3);
+			Assert::IsTrue(std::get<std::string_view>(actual.at(0).value).data() == input.data());
+			Assert::IsTrue(std::get<std::string_view>(actual.at(1).value).data() == input.data() + 8);
+			Assert::IsTrue(std::get<std::string_view>(actual.at(2).value).data() == input.data() + 18);
+		}
+		TEST_METHOD(InternIdentifiers) {
+			Interner interner;
+			std::string input{ "x = y + x\nif z: y" };
+			std::vector<Token> actual = Lexer::GenerateTokens(input, &interner);
+			Assert::IsTrue(interner.Size() == 3);
+			Assert::IsTrue(actual.at(0).symbol == 0);	// x
+			Assert::IsTrue(actual.at(2).symbol == 1);	// y
+			Assert::IsTrue(actual.at(4).symbol == 0);	// x
+			Assert::IsTrue(actual.at(6).symbol == no_symbol);	// keywords are not interned
+			Assert::IsTrue(actual.at(7).symbol == 2);	// z
+			Assert::IsTrue(actual.at(9).symbol == 1);	// y
+			Assert::IsTrue(interner.GetName(1) == "y");
+
+			// ids stay valid after the source is gone, and copies agree with the original
+			input.clear();
+			Interner copy = interner;
+			Assert::IsTrue(copy.Find("z") == SymbolId{ 2 });
+			Assert::IsTrue(copy.Intern("w") == 3);
+			Assert::IsFalse(interner.Find("w").has_value());
+			Assert::IsTrue(Lexer::GenerateTokens("y").front().symbol == no_symbol);
+		}
+		TEST_METHOD(TokenBufferValid) {
+			std::string input{ "# comment\nif x >= -12:\n\ty = 'str' % 3\nprint(x, not y)\n" };
+			Interner interner;
+			std::vector<Token> expected = Lexer::GenerateTokens(input, &interner);
+			Interner buffer_interner;
+			Lexer lexer(input, &buffer_interner);
+			TokenBuffer buffer(lexer);
+			Assert::IsTrue(buffer.Size() == expected.size());
+			for (size_t i = 0; i < buffer.Size(); ++i) {
+				const Token actual = buffer.GetToken(i);
+				Assert::AreEqual(expected.at(i), actual);
+				Assert::IsTrue(actual.kind == expected.at(i).kind);
+				Assert::IsTrue(actual.symbol == expected.at(i).symbol);
+				Assert::IsTrue(buffer.GetCategory(i) == actual.category && buffer.GetKind(i) == actual.kind);
+			}
+		}
+		TEST_METHOD(TokenLocation) {
+			std::string input{ "a\n\n  b + 'c'\nd" };
+			Lexer lexer(input);
+			TokenBuffer buffer(lexer);
+			auto AreEqual = [](SourceLocation expected, SourceLocation actual) {
+				Assert::IsTrue(expected.line == actual.line && expected.column == actual.column);
+			};
+			Assert::IsTrue(buffer.GetLineCount() == 4);
+			AreEqual({ 1, 1 }, buffer.GetLocation(0));	// a
+			AreEqual({ 1, 2 }, buffer.GetLocation(1));	// newline ending line 1
+			AreEqual({ 2, 1 }, buffer.GetLocation(2));	// blank line
+			AreEqual({ 3, 3 }, buffer.GetLocation(3));	// indent (one per space)
+			AreEqual({ 3, 3 }, buffer.GetLocation(5));	// b
+			AreEqual({ 3, 7 }, buffer.GetLocation(7));	// 'c'
+			AreEqual({ 4, 1 }, buffer.GetLocation(11));	// d
+			AreEqual({ 4, 2 }, buffer.GetLocation(buffer.Size()));	// end of file
+
+			// errors are located at the token that failed to lex
+			std::string bad_input{ "x = 1\ny = 2 $" };
+			Lexer bad_lexer(bad_input);
+			auto func = [&bad_lexer]() {TokenBuffer bad_buffer(bad_lexer); };
+			Assert::ExpectException<std::invalid_argument>(func);
+			AreEqual({ 2, 7 }, bad_lexer.GetTokenLocation());
+		}
+		TEST_METHOD(ParallelLexValid) {
+			// large enough to be split into chunks. indentation varies so that chunk seams fall inside blocks.
+			std::string input{};
+			for (int i = 0; input.size() < (size_t{ 4 } << 20); ++i) {
+				input += std::string(i % 5, '\t') + "name" + std::to_string(i % 1000) + " = 'text' + x # comment\n";
+				input += std::string(i % 3, ' ') + "if not y" + std::to_string(i % 7) + " <= 12345:\n";
+			}
+			Interner expected_interner;
+			Lexer lexer(input, &expected_interner);
+			TokenBuffer expected(lexer);
+			for (unsigned thread_count : { 1u, 2u, 3u, 4u }) {
+				Interner actual_interner;
+				TokenBuffer actual = TokenBuffer::Lex(input, &actual_interner, thread_count);
+				Assert::IsTrue(actual.Size() == expected.Size());
+				Assert::IsTrue(actual.GetLineCount() == expected.GetLineCount());
+				for (size_t i = 0; i < expected.Size(); ++i) {
+					const Token expected_token = expected.GetToken(i);
+					const Token actual_token = actual.GetToken(i);
+					Assert::IsTrue(expected_token == actual_token && expected_token.kind == actual_token.kind && expected_token.symbol == actual_token.symbol);
+					Assert::IsTrue(expected.GetOffset(i) == actual.GetOffset(i));
+				}
+				Assert::IsTrue(actual_interner.Size() == expected_interner.Size());
+				for (SymbolId id = 0; id < expected_interner.Size(); ++id) {
+					Assert::IsTrue(actual_interner.GetName(id) == expected_interner.GetName(id));
+				}
+			}
+
+			// the first error in the source is reported, with its location
+			const size_t first_error = input.find('\n', input.size() / 2) + 1;
+			input[first_error] = '$';
+			input[input.find('\n', input.size() / 4 * 3) + 1] = '$';
+			const size_t error_line = std::count(std::begin(input), std::begin(input) + first_error, '\n') + 1;
+			std::string actual_message{};
+			try {
+				TokenBuffer::Lex(input, nullptr, 4);
+			}
+			catch (const std::exception& ex) {
+				actual_message = ex.what();
+			}
+			const std::string expected_message = "line " + std::to_string(error_line) + ", column 1: invalid character";
+			Assert::AreEqual(expected_message, actual_message);
+		}
+	};
+	TEST_CLASS(ScannerTest) {
+	private:
+		template <typename F>
+		void ForEachSimdLevel(F func) {
+			// every implementation up to what this cpu supports must agree
+			const SimdLevel original = Scanner::GetSimdLevel();
+			for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 }) {
+				if (level > Scanner::GetMaxSimdLevel()) {
+					break;
+				}
+				Scanner::SetSimdLevel(level);
+				func();
+			}
+			Scanner::SetSimdLevel(original);
+		}
+	public:
+		TEST_METHOD(FindLineEnd) {
+			ForEachSimdLevel([] {
+				// place the terminator at every offset, so it is found in full vectors as well as in the tail
+				for (size_t length = 0; length < 100; ++length) {
+					std::string input(length, 'a');
+					input += '\n';
+					input += "tail";
+					const char* first = input.data();
+					Assert::IsTrue(Scanner::FindLineEnd(first, first + input.size()) == first + length);
+					input[length] = '\0';
+					Assert::IsTrue(Scanner::FindLineEnd(first, first + input.size()) == first + length);
+					Assert::IsTrue(Scanner::FindLineEnd(first, first + length) == first + length);
+				}
+			});
+		}
+		TEST_METHOD(FindStringLiteralEnd) {
+			ForEachSimdLevel([] {
+				for (size_t length = 0; length < 100; ++length) {
+					std::string input(length, '\'');
+					input += "\"\n";
+					const char* first = input.data();
+					Assert::IsTrue(Scanner::FindStringLiteralEnd(first, first + input.size(), '\"') == first + length);
+					Assert::IsTrue(Scanner::FindStringLiteralEnd(first + length + 1, first + input.size(), '\"') == first + length + 1);
+				}
+			});
+		}
+		TEST_METHOD(FindIdentifierEnd) {
+			ForEachSimdLevel([] {
+				const std::string identifier_chars{ "abcxyzABCXYZ_0189" };
+				for (size_t length = 0; length < 100; ++length) {
+					std::string input{};
+					for (size_t i = 0; i < length; ++i) {
+						input += identifier_chars[i % identifier_chars.size()];
+					}
+					for (char terminator : { ' ', '(', '@', '[', '`', '{', '/', ':', '~', '\x80', '\0' }) {
+						std::string terminated = input + terminator + "abc";
+						const char* first = terminated.data();
+						Assert::IsTrue(Scanner::FindIdentifierEnd(first, first + terminated.size()) == first + length);
+					}
+				}
+			});
+		}
+		TEST_METHOD(LexLongRuns) {
+			// runs longer than a vector should produce the same tokens at every level
+			const std::string long_text(200, 'x');
+			const std::string input = long_text + " \"" + long_text + "\" #" + long_text + "\n" + long_text + "~";
+			ForEachSimdLevel([&] {
+				std::vector<Token> actual = Lexer::GenerateTokens(std::string_view{ input }.substr(0, input.size() - 1));
+				std::vector<Token> expected{ {long_text, Category::Identifier}, {long_text, Category::StringLiteral}, {long_text, Category::Comment},
+					{"", Category::Newline}, {long_text, Category::Identifier} };
+				Assert::AreEqual(expected, actual);
+				auto func = [&]() {Lexer::GenerateTokens(input); };
+				Assert::ExpectException<std::invalid_argument>(func);
+			});
+		}
 	};
 	TEST_CLASS(ExecutionTest) {
 	public:
@@ -355,13 +580,503 @@ namespace tests
 				"print(\"Y + 3 is:\", y + 3)";
 			// test binary is in pysub/x64/Debug
 			FileExecution file("../../files_for_testing/read_file_test.py");
-			std::string actual = file.GetFileString();
+			std::string actual{ file.GetFileString() };
 			Assert::AreEqual(expected, actual);
 		}
+		TEST_METHOD(ReadFileStopsAtNull) {
+			const auto file_path = std::filesystem::temp_directory_path() / "pysub_read_file_null_test.py";
+			{
+				std::ofstream file_stream(file_path, std::ios::binary);
+				file_stream << std::string_view("x=1\n\0y=2\n", 9);
+			}
+			{
+				SourceBuffer source(file_path);
+				Assert::AreEqual(std::string{ "x=1\n" }, std::string{ source.GetView() });
+				FileExecution file(file_path.string());
+				Assert::AreEqual(std::string{ "x=1\n" }, std::string{ file.GetFileString() });
+			}
+			std::filesystem::remove(file_path);
+		}
+		TEST_METHOD(EditAfterReadValid) {
+			// a read keeps the text it read, so editing the file in place (even truncating it) does not affect it until it is read again
+			const auto file_path = std::filesystem::temp_directory_path() / "pysub_edit_after_read_test.py";
+			const std::filesystem::path cache_path = file_path.parent_path() / "__pysubcache__" / "pysub_edit_after_read_test.py.pysubc";
+			std::filesystem::remove(cache_path);
+			std::string text{};
+			for (int i = 0; i < 2000; ++i) {
+				text += "x" + std::to_string(i) + " = " + std::to_string(i) + " * 2\n";
+			}
+			{
+				std::ofstream file_stream(file_path, std::ios::binary);
+				file_stream << text;
+			}
+			FileExecution file(file_path.string());
+			std::filesystem::resize_file(file_path, 0);
+			file.Run();
+			Assert::IsTrue(file.GetSymbolTable().At(*file.GetInterner().Find("x1999")) == Value{ 3998 });
+			Assert::AreEqual(text, std::string{ file.GetFileString() });
+			Assert::AreEqual(Lexer::GenerateTokens(text), file.GetFileTokens());
+			std::filesystem::remove(file_path);
+			std::filesystem::remove(cache_path);
+		}
+		TEST_METHOD(ReadMissingFile) {
+			auto func = []() {SourceBuffer source("../../files_for_testing/does_not_exist.py"); };
+			Assert::ExpectException<std::runtime_error>(func);
+		}
+		TEST_METHOD(RunFileValid) {
+			const auto file_path = std::filesystem::temp_directory_path() / "pysub_run_test.py";
+			{
+				std::ofstream file_stream(file_path, std::ios::binary);
+				file_stream << "x = 2\ny = x * 3\nx = y - x\n";
+			}
+			FileExecution file(file_path.string());
+			file.Run();
+			const Interner& interner = file.GetInterner();
+			Assert::IsTrue(file.GetSymbolTable().At(*interner.Find("x")) == Value{ 4 });
+			Assert::IsTrue(file.GetSymbolTable().At(*interner.Find("y")) == Value{ 6 });
+			// each run starts afresh
+			file.Run();
+			Assert::IsTrue(file.GetSymbolTable().Size() == 2);
+			// a session can continue from where a run ended
+			InterfaceExecution session(file.Snapshot());
+			Assert::IsTrue(session.Run(Lexer::GenerateTokens("x * y", &session.GetInterner())) == Value{ 24 });
+			// the backend is chosen per execution
+			FileExecution closure_file(file_path.string(), Backend::Closures);
+			closure_file.Run();
+			Assert::IsTrue(closure_file.GetSymbolTable().At(*closure_file.GetInterner().Find("x")) == Value{ 4 });
+			auto disassemble = [&closure_file]() {closure_file.Disassemble(); };
+			Assert::ExpectException<std::invalid_argument>(disassemble);
+
+			{
+				std::ofstream file_stream(file_path, std::ios::binary);
+				file_stream << "x = 1\ny = x / 0\n";
+			}
+			FileExecution failing_file(file_path.string());
+			std::string message{};
+			try {
+				failing_file.Run();
+			}
+			catch (const std::exception& ex) {
+				message = ex.what();
+			}
+			Assert::AreEqual(std::string{ "runtime error: integer division or modulo by zero" }, message);
+			std::filesystem::remove(file_path);
+		}
+		TEST_METHOD(CacheValid) {
+			const auto file_path = std::filesystem::temp_directory_path() / "pysub_cache_test.py";
+			const auto cache_path = std::filesystem::temp_directory_path() / "__pysubcache__" / "pysub_cache_test.py.pysubc";
+			std::filesystem::remove(cache_path);
+			{
+				std::ofstream file_stream(file_path, std::ios::binary);
+				file_stream << "x = 2\ny = x * 3 < 7 or x\n# comment\nz = -y\n";
+			}
+			// the cache is written on the first run, and read instead of the source until the source changes
+			FileExecution first(file_path.string());
+			Assert::IsFalse(first.IsCached());
+			first.Run();
+			FileExecution second(file_path.string());
+			Assert::IsTrue(second.IsCached());
+			Assert::AreEqual(first.GetFileTokens(), second.GetFileTokens());
+			Assert::AreEqual(first.Disassemble(), second.Disassemble());
+			second.Run();
+			Assert::IsTrue(first.GetSymbolTable() == second.GetSymbolTable());
+			Assert::IsFalse(FileExecution(file_path.string(), second).IsCached());	// re-reads reuse the previous read instead
+			// it is keyed by a hash of the source, rather than holding a copy of it
+			{
+				std::ifstream cache_stream(cache_path, std::ios::binary);
+				const std::string cache_bytes{ std::istreambuf_iterator<char>(cache_stream), std::istreambuf_iterator<char>() };
+				Assert::IsTrue(cache_bytes.find("# comment") == std::string::npos);
+			}
+
+			// a damaged cache is ignored (and replaced)
+			const std::uintmax_t cache_size = std::filesystem::file_size(cache_path);
+			std::filesystem::resize_file(cache_path, cache_size - 1);
+			FileExecution third(file_path.string());
+			Assert::IsFalse(third.IsCached());
+			third.Run();
+			Assert::IsTrue(first.GetSymbolTable() == third.GetSymbolTable());
+			Assert::IsTrue(std::filesystem::file_size(cache_path) == cache_size);
+
+			{
+				std::ofstream file_stream(file_path, std::ios::binary);
+				file_stream << "x = 3\n";
+			}
+			FileExecution changed(file_path.string());
+			Assert::IsFalse(changed.IsCached());
+			changed.Run();
+			// a change that keeps the source's size changes its hash
+			{
+				std::ofstream file_stream(file_path, std::ios::binary);
+				file_stream << "x = 4\n";
+			}
+			Assert::IsFalse(FileExecution(file_path.string()).IsCached());
+			// closures are not cached
+			Assert::IsFalse(FileExecution(file_path.string(), Backend::Closures).IsCached());
+			std::filesystem::remove(file_path);
+			std::filesystem::remove(cache_path);
+		}
+		TEST_METHOD(ReReadValid) {
+			const auto file_path = std::filesystem::temp_directory_path() / "pysub_re_read_test.py";
+			auto WriteFile = [&file_path](std::string_view contents) {
+				std::ofstream file_stream(file_path, std::ios::binary);
+				file_stream << contents;
+			};
+			auto CompareTokens = [](const FileExecution& expected, const FileExecution& actual) {
+				const std::vector<Token> expected_tokens = expected.GetFileTokens();
+				const std::vector<Token> actual_tokens = actual.GetFileTokens();
+				Assert::AreEqual(expected_tokens, actual_tokens);
+				for (size_t i = 0; i < expected_tokens.size(); ++i) {
+					Assert::IsTrue(expected_tokens.at(i).kind == actual_tokens.at(i).kind);
+				}
+			};
+
+			WriteFile("x = 1\nif a:\n\tb\n\t\tc\n# comment\nd + 1\n\te\n");
+			FileExecution first(file_path.string());
+			// blocks are changed, moved, and indented differently at their seams
+			WriteFile("d + 1\n\te\n\t\tf\nx = 2\nif a:\n\tb\n\t\tc\n\tg\n# comment\n\n");
+			FileExecution second(file_path.string(), first);
+			CompareTokens(FileExecution(file_path.string()), second);
+
+			// trees parsed by an earlier run are reused, but a syntax error in a changed block still stops the run
+			WriteFile("1 + 2\n(3 * 4)\n5");
+			second = FileExecution(file_path.string(), second);
+			second.Run();
+			WriteFile("1 + 2\n(3 * 4\n5");
+			FileExecution third(file_path.string(), second);
+			CompareTokens(FileExecution(file_path.string()), third);
+			auto func = [&third]() {third.Run(); };
+			Assert::ExpectException<std::exception>(func);
+
+			// errors in re-lexed blocks are located within the whole file
+			WriteFile("1 + 2\n(3 * 4)\n5 $");
+			std::string message{};
+			try {
+				FileExecution fourth(file_path.string(), third);
+			}
+			catch (const std::exception& ex) {
+				message = ex.what();
+			}
+			Assert::AreEqual(std::string{ "lexer: line 3, column 3: invalid character" }, message);
+
+			// a file shrunk in place is matched against the text of the previous read, not the file it was read from
+			std::string lines{};
+			for (int i = 0; i < 6000; ++i) {
+				lines += "x" + std::to_string(i) + " = " + std::to_string(i) + "\n";
+			}
+			WriteFile(lines);
+			FileExecution long_file(file_path.string());
+			const std::string last_lines = lines.substr(lines.find("x3000 ="));
+			WriteFile(last_lines);
+			FileExecution short_file(file_path.string(), long_file);
+			CompareTokens(FileExecution(file_path.string()), short_file);
+			short_file.Run();
+			Assert::IsTrue(short_file.GetSymbolTable().At(*short_file.GetInterner().Find("x5999")) == Value{ 5999 });
+			Assert::IsFalse(short_file.GetSymbolTable().Find(*short_file.GetInterner().Find("x0")));
+			std::filesystem::remove(file_path);
+		}
+	};
+	TEST_CLASS(EvaluatorTest) {
+	private:
+		InterfaceExecution execution{};
+		InterfaceExecution closure_execution{ Backend::Closures };	// every line is also run with closures, which must agree
+
+		static std::optional<Value> RunLine(InterfaceExecution& line_execution, std::string_view line) {
+			std::vector<Token> tokens = Lexer::GenerateTokens(line, &line_execution.GetInterner());
+			return line_execution.Run(tokens);
+		}
+		std::optional<Value> RunLine(std::string_view line) {
+			const std::optional<Value> closure_value = RunLine(closure_execution, line);
+			const std::optional<Value> value = RunLine(execution, line);
+			Assert::IsTrue(value == closure_value);
+			return value;
+		}
+		void AssertValue(std::string_view expected, std::string_view line) {
+			std::optional<Value> actual = RunLine(line);
+			Assert::IsTrue(actual.has_value());
+			Assert::IsTrue(actual->IsInt());
+			Assert::AreEqual(std::string{ expected }, actual->ToString());
+		}
+		void AssertValue(int expected, std::string_view line) {
+			AssertValue(std::to_string(expected), line);
+		}
+		void AssertThrows(std::string_view line, const std::string& message) {
+			for (InterfaceExecution* line_execution : { &execution, &closure_execution }) {
+				std::string actual{};
+				try {
+					RunLine(*line_execution, line);
+				}
+				catch (const std::exception& ex) {
+					actual = ex.what();
+				}
+				Assert::AreEqual(message, actual);
+			}
+		}
+	public:
+		TEST_METHOD(ArithmeticValid) {
+			AssertValue(7, "1 + 2 * 3");
+			AssertValue(9, "(1 + 2) * 3");
+			AssertValue(-5, "--1 - 6");
+			// division is floor division, and the remainder takes the sign of the divisor (as in python)
+			AssertValue(3, "7 / 2");
+			AssertValue(-4, "-7 / 2");
+			AssertValue(2, "-7 % 3");
+			AssertValue(-2, "7 % -3");
+			// operators of the same precedence apply left to right
+			AssertValue(5, "10 - 2 - 3");
+			AssertValue(30, "100 / 5 / 2 * 3");
+			AssertValue(2, "x = 7\nx % 5 * x / 7");
+		}
+		TEST_METHOD(LogicValid) {
+			AssertValue(1, "1 < 2");
+			AssertValue(0, "2 <= 1");
+			AssertValue(1, "not 0");
+			// 'and' and 'or' give the deciding operand, and skip the other
+			AssertValue(5, "0 or 5");
+			AssertValue(0, "3 and 0");
+			AssertValue(0, "0 and 1 / 0");
+			AssertValue(4, "4 or 1 / 0");
+			AssertValue(2, "0 and 1 or 2");
+			AssertValue(0, "1 and 0 and 1 / 0");
+			// comparisons chain, unless grouped
+			AssertValue(1, "3 > 2 > 1");
+			AssertValue(0, "(3 > 2) > 1");
+			AssertValue(0, "1 < 3 < 2");
+			AssertValue(1, "1 == 1 != 2");
+		}
+		TEST_METHOD(AssignmentValid) {
+			Assert::IsFalse(RunLine("x = 6").has_value());
+			Assert::IsFalse(RunLine("y = x * 7").has_value());
+			AssertValue(42, "y");
+			RunLine("x = x + 1");
+			AssertValue(7, "x");
+
+			const SymbolTable& symbol_table = execution.GetSymbolTable();
+			const SymbolId x = *execution.GetInterner().Find("x");
+			const SymbolId y = *execution.GetInterner().Find("y");
+			Assert::IsTrue(symbol_table.Size() == 2);
+			Assert::IsTrue(symbol_table.At(y) == Value{ 42 });
+
+			// the table grows a slot for each name as it appears, and lists variables in the order they were first assigned
+			RunLine("a = 1");
+			AssertThrows("b = c", "name 'c' is not defined");
+			RunLine("a = y");
+			Assert::IsTrue(symbol_table.GetSlotCount() == execution.GetInterner().Size());
+			const SymbolId a = *execution.GetInterner().Find("a");
+			Assert::IsTrue(symbol_table.GetAssigned() == std::vector<SymbolId>{ x, y, a });
+			Assert::IsTrue(symbol_table.At(a) == Value{ 42 });
+		}
+		TEST_METHOD(BigIntValid) {
+			// ints do not overflow; results too large for a small int become big ints, and small again once they fit
+			AssertValue("2147483648", "2147483647 + 1");
+			AssertValue("4611686018427387904", "4611686018427387903 + 1");
+			AssertValue("9223372036854775808", "9223372036854775807 + 1");
+			AssertValue("-9223372036854775809", "-9223372036854775807 - 2");
+			AssertValue("340282366920938463463374607431768211456", "18446744073709551616 * 18446744073709551616");
+			AssertValue(1, "18446744073709551616 - 18446744073709551615");
+			AssertValue(1, "-(18446744073709551616 - 18446744073709551617)");
+			// floor division and modulo as for small ints
+			AssertValue(1, "18446744073709551616 / 18446744073709551615");
+			AssertValue(-2, "-18446744073709551616 / 18446744073709551615");
+			AssertValue("18446744073709551614", "-18446744073709551616 % 18446744073709551615");
+			AssertValue("-1", "18446744073709551616 % -18446744073709551617");
+			AssertValue("-4611686018427387904", "-4611686018427387904 / 1");
+			AssertValue("4611686018427387904", "-4611686018427387904 / -1");
+			AssertValue("4611686018427387904", "-(-4611686018427387904)");
+			// comparisons and truth
+			AssertValue(1, "-18446744073709551616 < 0 < 18446744073709551616 > 18446744073709551615");
+			AssertValue(1, "18446744073709551616 == 18446744073709551615 + 1");
+			AssertValue(0, "18446744073709551616 == 18446744073709551615");
+			AssertValue(0, "not 18446744073709551616");
+			AssertValue("18446744073709551616", "0 or 18446744073709551616");
+			// variables hold big ints
+			RunLine("x = 4294967296");
+			RunLine("y = x * x * x * x");
+			AssertValue("340282366920938463463374607431768211456", "y");
+			AssertValue(1, "y / x / x / x == x");
+		}
+		TEST_METHOD(SnapshotValid) {
+			// executions are moved, not copied; state is shared through snapshots instead
+			static_assert(!std::is_copy_constructible_v<Execution> && std::is_nothrow_move_constructible_v<Execution>);
+			static_assert(!std::is_copy_assignable_v<InterfaceExecution> && !std::is_copy_assignable_v<FileExecution>);
+
+			RunLine(execution, "x = 2");
+			RunLine(execution, "y = x * 3");
+			const ExecutionSnapshot snapshot = execution.Snapshot();
+			Assert::IsTrue(&snapshot.GetSymbolTable() == &execution.GetSymbolTable());	// taken without copying
+
+			// the snapshot keeps the state it was taken in
+			RunLine(execution, "x = 10");
+			RunLine(execution, "z = 1");
+			const SymbolId x = *snapshot.GetInterner().Find("x");
+			Assert::IsTrue(snapshot.GetSymbolTable().At(x) == Value{ 2 } && snapshot.GetSymbolTable().Size() == 2);
+			Assert::IsFalse(snapshot.GetInterner().Find("z").has_value());
+
+			// sessions forked from it are independent of each other
+			InterfaceExecution fork(snapshot);
+			InterfaceExecution other_fork(snapshot);
+			Assert::IsTrue(RunLine(fork, "x = x + y") == std::nullopt && RunLine(fork, "x") == Value{ 8 });
+			Assert::IsTrue(RunLine(other_fork, "x") == Value{ 2 });
+			Assert::IsTrue(snapshot.GetSymbolTable().At(x) == Value{ 2 });
+
+			// and restoring returns to it, names included
+			execution.Restore(snapshot);
+			Assert::IsTrue(RunLine(execution, "x + y") == Value{ 8 });
+			auto undefined = [this]() {RunLine(execution, "z"); };
+			Assert::ExpectException<std::runtime_error>(undefined);
+			Assert::IsTrue(snapshot.GetBackend() == Backend::Bytecode);
+		}
+		TEST_METHOD(RuntimeErrors) {
+			AssertThrows("1 / 0", "integer division or modulo by zero");
+			AssertThrows("1 % 0", "integer modulo by zero");
+			AssertThrows("18446744073709551616 / 0", "integer division or modulo by zero");
+			AssertThrows("undefined + 1", "name 'undefined' is not defined");
+			// a failed assignment leaves the variable unset
+			AssertThrows("z = 1 / 0", "integer division or modulo by zero");
+			Assert::IsFalse(execution.GetInterner().Find("z") && execution.GetSymbolTable().Find(*execution.GetInterner().Find("z")));
+		}
+		TEST_METHOD(DeepNestingValid) {
+			// compiling walks the tree without recursing, and chains run in a loop, so long chains are not limited
+			auto Repeat = [](std::string_view first, std::string_view next, size_t count) {
+				std::string line{ first };
+				for (size_t i = 1; i < count; ++i) {
+					line += next;
+				}
+				return line;
+			};
+			RunLine("y = 1");
+			Assert::IsTrue(RunLine(Repeat("y", " + y", 1500)) == Value{ 1500 });
+			Assert::IsTrue(RunLine(Repeat("y", " - y + y", 1500)) == Value{ 1 });
+			Assert::IsTrue(RunLine(Repeat("y", " and y", 1500)) == Value{ 1 });
+			Assert::IsTrue(RunLine(Repeat("y", " == y", 1500)) == Value{ 1 });
+			Assert::IsTrue(RunLine(std::string(2000, '(') + "y" + std::string(2000, ')')) == Value{ 1 });
+
+			// deep nesting is only limited where running recurses
+			const std::string nested = Repeat("y", " + (y", 2000) + std::string(1999, ')');
+			Assert::IsTrue(RunLine(execution, nested) == Value{ 2000 });
+			auto run_closures = [this, &nested]() {RunLine(closure_execution, nested); };
+			Assert::ExpectException<std::runtime_error>(run_closures);
+		}
+	};
+	TEST_CLASS(BytecodeTest) {
+	public:
+		TEST_METHOD(DisassembleValid) {
+			InterfaceExecution execution{};
+			auto RunLine = [&execution](std::string_view line) {
+				return execution.Run(Lexer::GenerateTokens(line, &execution.GetInterner()));
+			};
+			RunLine("y = 2");
+			Assert::AreEqual(std::string{
+				"statement 1:\n"
+				"\t   0 PushInteger       2\n"
+				"\t   1 StoreName         y\n"
+				"\t   2 ReturnNone\n" }, execution.Disassemble());
+
+			// a chained comparison skips the rest of the chain once a comparison is false
+			Assert::IsTrue(RunLine("1 < y < 3") == Value{ 1 });
+			Assert::AreEqual(std::string{
+				"statement 1:\n"
+				"\t   0 PushInteger       1\n"
+				"\t   1 LoadName          y\n"
+				"\t   2 Duplicate\n"
+				"\t   3 RotateThree\n"
+				"\t   4 Less\n"
+				"\t   5 JumpIfFalseOrPop  to 9\n"
+				"\t   6 PushInteger       3\n"
+				"\t   7 Less\n"
+				"\t   8 Jump              to 11\n"
+				"\t   9 Swap\n"
+				"\t  10 Pop\n"
+				"\t  11 Return\n" }, execution.Disassemble());
+
+			// ints too large for an operand are constants
+			Assert::IsTrue(RunLine("y + 2147483648") == Value{ 2147483650 });
+			Assert::AreEqual(std::string{
+				"statement 1:\n"
+				"\t   0 LoadName          y\n"
+				"\t   1 PushConstant      2147483648\n"
+				"\t   2 Add\n"
+				"\t   3 Return\n" }, execution.Disassemble());
+		}
+		TEST_METHOD(StackSizeValid) {
+			// the stack only needs room for the operands waiting on an operator at once
+			Interner interner{};
+			std::vector<Token> tokens = Lexer::GenerateTokens("1 + 2 + 3 + 4\n1 + (2 + (3 + 4))\n", &interner);
+			Parser parser(tokens);
+			std::unique_ptr<AST> tree = parser.BuildTree();
+			Bytecode code = Bytecode::Compile(FlatTree(*tree), interner);
+			Assert::AreEqual(uint32_t{ 4 }, code.GetMaxStackSize());
+
+			tokens = Lexer::GenerateTokens("1 + 2 + 3 + 4\n", &interner);
+			Parser flat_parser(tokens);
+			tree = flat_parser.BuildTree();
+			code = Bytecode::Compile(FlatTree(*tree), interner);
+			Assert::AreEqual(uint32_t{ 2 }, code.GetMaxStackSize());
+		}
+	};
+	TEST_CLASS(OptimizerTest) {
+	private:
+		// the optimized line, and the number of nodes eliminated
+		static std::pair<std::string, size_t> Optimize(std::string_view line) {
+			std::vector<Token> tokens = Lexer::GenerateTokens(line);
+			Parser parser(tokens);
+			std::unique_ptr<AST> tree = parser.BuildTree();
+			const size_t eliminated = Optimizer(*tree).Optimize();
+			std::string optimized = FlatTree(*tree).ToString();
+			optimized.pop_back();	// the newline
+			return { optimized, eliminated };
+		}
+		static void AssertOptimized(std::string_view expected, std::string_view line) {
+			Assert::AreEqual(std::string{ expected }, Optimize(line).first);
+		}
+	public:
+		TEST_METHOD(FoldingValid) {
+			Assert::IsTrue(Optimize("(3 * 4) + x - 0") == std::pair<std::string, size_t>{ "(12 + x)", 5 });
+			AssertOptimized("y = 7", "y = 1 + 2 * 3");
+			AssertOptimized("-3", "-+--3");
+			AssertOptimized("1", "not 0");
+			// errors are left for run time
+			AssertOptimized("(1 / 0)", "1 / 0");
+			// ints do not overflow, but only results that fit inline are folded
+			AssertOptimized("2147483648", "2147483647 + 1");
+			AssertOptimized("(4611686018427387903 + 1)", "4611686018427387903 + 1");
+			AssertOptimized("(9223372036854775808 * 2)", "9223372036854775808 * 2");
+		}
+		TEST_METHOD(SimplificationValid) {
+			AssertOptimized("x", "--x");
+			AssertOptimized("x", "+(x)");
+			AssertOptimized("not x", "not not not x");
+			AssertOptimized("not not x", "not not x");	// 1 or 0, not x
+			AssertOptimized("x", "1 * x / 1 + 0");
+			AssertOptimized("(x * 0)", "x * 0");	// x still has to be looked up
+			AssertOptimized("0", "0 and x");
+			AssertOptimized("x", "1 and x");
+			AssertOptimized("(x and 0)", "x and 0");
+		}
+		TEST_METHOD(ComparisonsValid) {
+			// chains are folded as a whole, and a grouping that stops a chain is kept
+			AssertOptimized("1", "3 > 2 > 1");
+			AssertOptimized("0", "(3 > 2) > 1");
+			AssertOptimized("((x < 2) < 3)", "x < 2 < 3");
+			AssertOptimized("(((x < y)) < 3)", "((x < y)) < 3");
+			AssertOptimized("(((x < y)) < 3)", "(x < y) * 1 < 3");
+			AssertOptimized("(x < (y < 3))", "x < (y < 3)");
+		}
+		TEST_METHOD(DeepNestingValid) {
+			// the tree is walked without recursing, so deep subtrees are optimized too
+			constexpr size_t depth = 5000;
+			std::string sum = "1";
+			for (size_t i = 1; i < depth; ++i) {
+				sum += " + (1";
+			}
+			sum += std::string(depth - 1, ')');
+			AssertOptimized(std::to_string(depth), sum);
+			AssertOptimized("x", std::string(depth, '(') + "x" + std::string(depth, ')') + std::string(depth, '+') + " 0");
+			AssertOptimized("1", std::string(depth, '(') + "1 < 2 < 3" + std::string(depth, ')'));
+		}
 	};
 	TEST_CLASS(ParserTest) {
 	private:
-		void CompareVectorsOfStatements(const std::vector<std::unique_ptr<Statement>>& l, const std::vector<std::unique_ptr<Statement>>& r) {
+		void CompareVectorsOfStatements(const std::vector<Statement*>& l, const std::vector<Statement*>& r) {
 			Assert::IsTrue(l.size() == r.size());
 			auto l_iter = std::cbegin(l);
 			auto r_iter = std::cbegin(r);
@@ -396,8 +1111,9 @@ namespace tests
 			Parser p(tokens);
 			auto tree = p.BuildTree();
 
-			std::vector<std::unique_ptr<Statement>> res{};
-			res.push_back(std::make_unique<Atom>(numeric_atom));
+			Arena arena{};
+			std::vector<Statement*> res{};
+			res.push_back(arena.Make<Atom>(numeric_atom));
 			
 			CompareVectorsOfStatements(tree->statements, res);
 
@@ -409,6 +1125,112 @@ namespace tests
 			//auto identifier_atom_tree = parser_identifier.BuildTree();
 			//Assert::AreEqual(identifier_atom_tree->statements, { std::move(std::make_unique<Atom>(identifier_atom)) });
 		}
+		TEST_METHOD(OperatorPrecedenceValid) {
+			std::string input{ "1 + 2 * 3 < 4 and not 5" };
+			std::vector<Token> tokens = Lexer::GenerateTokens(input);
+			Parser p(tokens);
+			auto tree = p.BuildTree();
+
+			// ((1 + (2 * 3)) < 4) and (not 5)
+			Arena arena{};
+			auto product = arena.Make<BinaryExpression>(arena.Make<Atom>(Token{ 2, Category::NumericLiteral }),
+				Token{ "*", Category::ArithmeticOperator }, arena.Make<Atom>(Token{ 3, Category::NumericLiteral }));
+			auto sum = arena.Make<BinaryExpression>(arena.Make<Atom>(Token{ 1, Category::NumericLiteral }),
+				Token{ "+", Category::ArithmeticOperator }, product);
+			auto comparison = arena.Make<BinaryExpression>(sum,
+				Token{ "<", Category::RelationalOperator }, arena.Make<Atom>(Token{ 4, Category::NumericLiteral }));
+			auto inversion = arena.Make<UnaryExpression>(arena.Make<Atom>(Token{ 5, Category::NumericLiteral }),
+				Token{ "not", Category::LogicalOperator });
+			std::vector<Statement*> res{};
+			res.push_back(arena.Make<BinaryExpression>(comparison, Token{ "and", Category::LogicalOperator }, inversion));
+
+			CompareVectorsOfStatements(tree->statements, res);
+		}
+		TEST_METHOD(StreamingValid) {
+			// parsing straight from a lexer gives the same tree as parsing the generated vector
+			std::string input{ "1 + 2 * (3 - 4)\n# comment\nnot 5 or 6\n" };
+			std::vector<Token> tokens = Lexer::GenerateTokens(input);
+			Parser vector_parser(tokens);
+			auto expected = vector_parser.BuildTree();
+
+			Lexer lexer(input);
+			Parser streaming_parser(lexer);
+			auto actual = streaming_parser.BuildTree();
+
+			CompareVectorsOfStatements(actual->statements, expected->statements);
+		}
+		TEST_METHOD(StreamingLookahead) {
+			std::string input{ "a = 1" };
+			Lexer lexer(input);
+			TokenStream stream(lexer);
+			Assert::IsTrue(stream.Peek(2) == Token{ 1, Category::NumericLiteral });
+			Assert::IsTrue(stream.Peek() == Token{ "a", Category::Identifier });
+			stream.Advance();
+			Assert::IsTrue(stream.Peek().category == Category::AssignmentOperator);
+			Assert::IsFalse(stream.IsAtEnd(1));
+			Assert::IsTrue(stream.IsAtEnd(2));
+		}
+		TEST_METHOD(ErrorLocation) {
+			std::string input{ "1 + 2\n3 * (4 - )" };
+			Lexer lexer(input);
+			TokenBuffer buffer(lexer);
+			Parser p(buffer);
+			auto func = [&p]() {auto res = p.BuildTree(); };
+			Assert::ExpectException<std::runtime_error>(func);
+			Assert::IsTrue(p.GetLocation().has_value());
+			Assert::IsTrue(p.GetLocation()->line == 2 && p.GetLocation()->column == 10);	// the unexpected ')'
+		}
+		TEST_METHOD(FlatTreeValid) {
+			std::string input{ "1 + 2 * 3 < 4 and not 5\n-(a - b) * c\n7" };
+			std::vector<Token> tokens = Lexer::GenerateTokens(input);
+			Parser p(tokens);
+			FlatTree flat(*p.BuildTree());
+			Assert::AreEqual(std::string{ "(((1 + (2 * 3)) < 4) and not 5)\n(-((a - b)) * c)\n7\n" }, flat.ToString());
+
+			// children are found from subtree sizes
+			const std::vector<uint32_t> roots{ 9, 16, 17 };
+			Assert::IsTrue(flat.GetRoots() == roots);
+			const uint32_t product = 16;
+			Assert::IsTrue(flat.GetNodes()[product].size == 7);
+			Assert::IsTrue(flat.GetToken(flat.GetRightChild(product)) == Token{ "c", Category::Identifier });
+			const uint32_t negation = flat.GetLeftChild(product);
+			Assert::IsTrue(flat.GetNodes()[negation].kind == NodeKind::UnaryExpression);
+			Assert::IsTrue(flat.GetNodes()[flat.GetOnlyChild(negation)].kind == NodeKind::Grouping);
+
+			auto Flatten = [](std::string_view other_input) {
+				std::vector<Token> other_tokens = Lexer::GenerateTokens(other_input);
+				Parser other_parser(other_tokens);
+				return FlatTree(*other_parser.BuildTree());
+			};
+			Assert::IsTrue(flat == Flatten(input));
+			Assert::IsFalse(flat == Flatten("1 + 2 * 3 < 4 and not 5\n-(a - b) * c\n8"));
+			Assert::IsFalse(flat == Flatten("1 + 2 * 3 < 4 and not 5\n-(a - b * c)\n7"));
+		}
+		TEST_METHOD(StackedUnaryValid) {
+			// factor: ('+' | '-') factor | primary
+			std::string input{ "5 - - -1 * 2" };
+			std::vector<Token> tokens = Lexer::GenerateTokens(input);
+			Parser p(tokens);
+			Assert::AreEqual(std::string{ "(5 - (--1 * 2))\n" }, FlatTree(*p.BuildTree()).ToString());
+
+			// 'not' cannot follow an operator that binds more tightly
+			std::vector<Token> invalid_tokens = Lexer::GenerateTokens("1 + not 2");
+			Parser invalid_parser(invalid_tokens);
+			auto func = [&invalid_parser]() {auto res = invalid_parser.BuildTree(); };
+			Assert::ExpectException<std::runtime_error>(func);
+		}
+		TEST_METHOD(DeepNestingValid) {
+			// nesting is limited by memory, not by the native stack
+			constexpr size_t depth = 100000;
+			std::string input = std::string(depth, '(') + "1" + std::string(depth, ')') + " + " + std::string(depth, '-') + "2";
+			Lexer lexer(input);
+			TokenBuffer buffer(lexer);
+			Parser p(buffer);
+			auto tree = p.BuildTree();
+			FlatTree flat(*tree);
+			Assert::IsTrue(flat.GetNodes().size() == 2 * depth + 3);
+			Assert::IsTrue(flat.GetNodes()[flat.GetRoots().front()].kind == NodeKind::BinaryExpression);
+		}
 		//TEST_METHOD(SingleAtomInvalid) {
 		//	Token invalid_atom = Token{ .value = "+", .category = Category::ArithmeticOperator};
 		//	std::vector<Token> tokens{
@@ -420,6 +1242,278 @@ namespace tests
 		//}
 	};
 
+	TEST_CLASS(ArenaTest) {
+	public:
+		TEST_METHOD(AllocationValid) {
+			Arena arena{};
+			Assert::IsTrue(arena.GetBytesReserved() == 0);
+
+			// objects are aligned, and do not overlap
+			char* c = arena.Make<char>('a');
+			double* d = arena.Make<double>(1.5);
+			Assert::IsTrue(reinterpret_cast<uintptr_t>(d) % alignof(double) == 0);
+			Assert::IsTrue(*c == 'a' && *d == 1.5);
+
+			// an allocation larger than any block gets its own
+			constexpr size_t large_size = size_t{ 4 } << 20;
+			std::byte* large = static_cast<std::byte*>(arena.Allocate(large_size, 1));
+			std::fill(large, large + large_size, std::byte{ 0xff });
+			Assert::IsTrue(arena.GetBytesReserved() > large_size);
+
+			// many small allocations span several blocks
+			std::vector<int*> ints{};
+			for (int i = 0; i < 100000; ++i) {
+				ints.push_back(arena.Make<int>(i));
+			}
+			for (int i = 0; i < 100000; ++i) {
+				Assert::IsTrue(*ints[i] == i);
+			}
+
+			// moving the arena keeps its objects in place
+			Arena moved(std::move(arena));
+			Assert::IsTrue(*c == 'a' && *ints.back() == 99999);
+			Assert::IsTrue(arena.GetBytesReserved() == 0);
+		}
+	};
+
+	TEST_CLASS(FlatMapTest) {
+	public:
+		TEST_METHOD(InsertionValid) {
+			FlatMap<uint32_t, int> map{};
+			Assert::IsTrue(map.empty() && map.bucket_count() == 0);
+			Assert::IsTrue(map.find(1) == map.end() && !map.contains(1));
+
+			// enough keys to grow many times, inserted out of order
+			constexpr uint32_t count = 10000;
+			for (uint32_t i = 0; i < count; ++i) {
+				const uint32_t key = (i * 7919) % count;
+				Assert::IsTrue(map.try_emplace(key, static_cast<int>(key) * 2).second);
+			}
+			Assert::IsTrue(map.size() == count && map.bucket_count() >= count);
+			for (uint32_t key = 0; key < count; ++key) {
+				Assert::IsTrue(map.contains(key));
+				Assert::AreEqual(static_cast<int>(key) * 2, map.at(key));
+			}
+			Assert::IsFalse(map.contains(count));
+			auto missing = [&map, count]() {map.at(count); };
+			Assert::ExpectException<std::out_of_range>(missing);
+
+			// entries are kept in the order they were first inserted, whatever is assigned to them after
+			Assert::IsFalse(map.try_emplace(7919 % count, -1).second);
+			Assert::IsFalse(map.insert_or_assign(0, -1).second);
+			map[7919 % count] = 5;
+			uint32_t i = 0;
+			for (const auto& [key, value] : map) {
+				Assert::IsTrue(key == (i * 7919) % count);
+				Assert::AreEqual(key == 0 ? -1 : key == 7919 % count ? 5 : static_cast<int>(key) * 2, value);
+				++i;
+			}
+
+			// copies are independent
+			FlatMap<uint32_t, int> copy = map;
+			copy[count] = 1;
+			Assert::IsTrue(copy.size() == count + 1 && map.size() == count && !map.contains(count));
+			copy = map;
+			Assert::IsFalse(copy.contains(count));
+
+			// clearing keeps the table
+			const size_t bucket_count = map.bucket_count();
+			map.clear();
+			Assert::IsTrue(map.empty() && !map.contains(0) && map.bucket_count() == bucket_count);
+			map.reserve(100000);
+			Assert::IsTrue(map.bucket_count() >= 100000);
+			map.insert_or_assign(3, 4);
+			Assert::IsTrue(map.bucket_count() >= 100000 && map.at(3) == 4);
+		}
+		TEST_METHOD(ThrowingInsertionValid) {
+			// an entry that fails to construct leaves nothing behind, even when the insertion grew the table for it
+			struct Fragile {
+				int value;
+				explicit Fragile(int _value) : value(_value) {
+					if (value < 0) {
+						throw std::invalid_argument("negative value");
+					}
+				}
+			};
+			FlatMap<uint32_t, Fragile> map{};
+			for (uint32_t key = 0; key < 100; ++key) {
+				auto insert = [&map, key]() {map.try_emplace(key, -1); };
+				Assert::ExpectException<std::invalid_argument>(insert);
+				Assert::IsTrue(map.size() == key && !map.contains(key));
+				Assert::IsTrue(map.try_emplace(key, static_cast<int>(key)).second);
+			}
+			for (uint32_t key = 0; key < 100; ++key) {
+				Assert::AreEqual(static_cast<int>(key), map.at(key).value);
+			}
+		}
+	};
+
+	TEST_CLASS(SymbolTableTest) {
+	public:
+		TEST_METHOD(SlotsValid) {
+			SymbolTable table{};
+			Assert::IsTrue(table.GetSlotCount() == 0 && table.Find(0) == nullptr);
+			table.Grow(4);
+			table.Grow(2);	// never shrinks
+			Assert::IsTrue(table.GetSlotCount() == 4 && table.Size() == 0 && table.Find(3) == nullptr);
+
+			table.Assign(2, 5);
+			table.Assign(0, 6);
+			table.Assign(2, 7);
+			Assert::IsTrue(table.Size() == 2 && table.GetAssigned() == std::vector<SymbolId>{ 2, 0 });
+			Assert::IsTrue(*table.Find(2) == Value{ 7 } && table.At(0) == Value{ 6 });
+			Assert::IsTrue(table.Find(1) == nullptr && table.Find(4) == nullptr);
+			auto unassigned = [&table]() {table.At(1); };
+			Assert::ExpectException<std::out_of_range>(unassigned);
+
+			// tables are equal with the same variables, however many slots they have and in whatever order they were assigned
+			SymbolTable other{};
+			other.Grow(8);
+			other.Assign(0, 6);
+			Assert::IsFalse(other == table);
+			other.Assign(2, 7);
+			Assert::IsTrue(other == table);
+			other.Assign(2, 8);
+			Assert::IsFalse(other == table);
+		}
+	};
+
+	TEST_CLASS(ValueTest) {
+	public:
+		TEST_METHOD(IntValid) {
+			for (int64_t integer : { int64_t{ 0 }, int64_t{ 1 }, int64_t{ -1 }, Value::max_small_int, Value::min_small_int }) {
+				const Value value = integer;
+				Assert::IsTrue(value.IsSmallInt() && value.IsInt() && !value.IsString());
+				Assert::IsTrue(value.GetSmallInt() == integer);
+			}
+			Assert::IsTrue(Value{} == Value{ 0 });
+			Assert::IsFalse(Value{ 1 } == Value{ 2 });
+
+			// ints that do not fit inline are big ints, however they are made
+			for (int64_t integer : { Value::max_small_int + 1, Value::min_small_int - 1, std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min() }) {
+				const Value value = integer;
+				Assert::IsTrue(value.IsBigInt() && value.IsInt() && !value.IsString());
+				Assert::IsTrue(value.GetBigInt().ToInt64() == integer);
+				Assert::IsTrue(value == Value{ BigInt(integer) });
+				Assert::AreEqual(std::to_string(integer), value.ToString());
+			}
+			Assert::IsTrue(Value{ BigInt(5) }.IsSmallInt());
+			Assert::IsFalse(Value{ Value::max_small_int + 1 } == Value{ Value::max_small_int });
+
+			// copies share the big int
+			Value value{ BigInt::FromString("18446744073709551616") };
+			const Value copy = value;
+			Assert::IsTrue(&copy.GetBigInt() == &value.GetBigInt());
+			value = 0;
+			Assert::AreEqual(std::string{ "18446744073709551616" }, copy.ToString());
+
+			// ints assigned in place, over values of either kind
+			value = copy;
+			value.AssignInt(7);
+			Assert::IsTrue(value.IsSmallInt() && value.GetSmallInt() == 7);
+			value.AssignOverSmallInt(Value::max_small_int + 1);
+			Assert::IsTrue(value.IsBigInt() && value.GetBigInt().ToInt64() == Value::max_small_int + 1);
+			value.AssignInt(-1);
+			Assert::IsTrue(value == Value{ -1 });
+		}
+		TEST_METHOD(StringValid) {
+			Value value{ std::string_view{ "hello" } };
+			Assert::IsTrue(value.IsString());
+			Assert::AreEqual(std::string{ "hello" }, std::string{ value.GetString() });
+			Assert::IsTrue(Value{ std::string_view{} }.GetString().empty());
+
+			// copies share the string, and outlive the original
+			Value copy = value;
+			Assert::IsTrue(copy.GetString().data() == value.GetString().data());
+			value = 3;
+			Assert::AreEqual(std::string{ "hello" }, std::string{ copy.GetString() });
+			Value moved = std::move(copy);
+			Assert::IsTrue(copy.IsInt() && moved.IsString());
+			moved = moved;
+			Assert::AreEqual(std::string{ "hello" }, std::string{ moved.GetString() });
+
+			// strings are compared by their text
+			Assert::IsTrue(moved == Value{ std::string_view{ "hello" } });
+			Assert::IsFalse(moved == Value{ std::string_view{ "world" } });
+			Assert::IsFalse(moved == Value{ 0 });
+		}
+	};
+
+	TEST_CLASS(BigIntTest) {
+	private:
+		// a number of the given digits, repeating a pattern that is not a power of two
+		static BigInt MakeNumber(size_t digit_count) {
+			std::string digits{};
+			for (size_t i = 0; i < digit_count; ++i) {
+				digits += static_cast<char>('1' + (i * 7) % 9);
+			}
+			return BigInt::FromString(digits);
+		}
+	public:
+		TEST_METHOD(StringValid) {
+			for (std::string_view digits : { "0", "7", "-7", "4294967296", "-18446744073709551616", "123456789012345678901234567890" }) {
+				Assert::AreEqual(std::string{ digits }, BigInt::FromString(digits).ToString());
+			}
+			Assert::AreEqual(std::string{ "12" }, BigInt::FromString("00012").ToString());
+			Assert::AreEqual(std::string{ "0" }, BigInt::FromString("-0").ToString());
+			Assert::IsFalse(BigInt::FromString("-0").IsNegative());
+			const std::string long_digits = "9" + std::string(999, '0');
+			Assert::AreEqual(long_digits, BigInt::FromString(long_digits).ToString());
+
+			for (std::string_view invalid : { "", "-", "12a", "+1", " 1" }) {
+				auto func = [invalid]() {BigInt::FromString(invalid); };
+				Assert::ExpectException<std::invalid_argument>(func);
+			}
+		}
+		TEST_METHOD(Int64Valid) {
+			for (int64_t integer : { int64_t{ 0 }, int64_t{ -1 }, std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min() }) {
+				Assert::IsTrue(BigInt(integer).ToInt64() == integer);
+				Assert::AreEqual(std::to_string(integer), BigInt(integer).ToString());
+			}
+			Assert::IsFalse(BigInt::FromString("9223372036854775808").ToInt64().has_value());
+			Assert::IsFalse(BigInt::FromString("-9223372036854775809").ToInt64().has_value());
+			Assert::IsTrue(BigInt::FromString("-9223372036854775809") < BigInt(std::numeric_limits<int64_t>::min()));
+		}
+		TEST_METHOD(MultiplyValid) {
+			// (10^n - 1)^2 = 99..9800..01, at sizes either side of the switch to karatsuba
+			for (size_t digit_count : { 5, 100, 300, 320, 1000, 3000 }) {
+				const BigInt nines = BigInt::FromString(std::string(digit_count, '9'));
+				const std::string expected = std::string(digit_count - 1, '9') + "8" + std::string(digit_count - 1, '0') + "1";
+				Assert::AreEqual(expected, (nines * nines).ToString());
+				Assert::AreEqual(expected, ((-nines) * (-nines)).ToString());
+				Assert::AreEqual("-" + expected, ((-nines) * nines).ToString());
+			}
+			// unbalanced operands, checked against division and (a + b)(a - b) = a^2 - b^2
+			for (auto [left_digits, right_digits] : { std::pair<size_t, size_t>{ 2000, 350 }, { 3000, 40 }, { 700, 650 }, { 5000, 1 } }) {
+				const BigInt left = MakeNumber(left_digits);
+				const BigInt right = MakeNumber(right_digits);
+				const BigInt product = left * right;
+				Assert::IsTrue(product == right * left);
+				Assert::IsTrue(BigInt::DivideModulo(product, right) == std::pair{ left, BigInt{} });
+				Assert::IsTrue(BigInt::DivideModulo(product + right - BigInt(1), right) == std::pair{ left, right - BigInt(1) });
+				Assert::IsTrue((left + right) * (left - right) == left * left - right * right);
+			}
+			Assert::IsTrue((MakeNumber(500) * BigInt{}).IsZero());
+		}
+		TEST_METHOD(DivideModuloValid) {
+			// floor division: the remainder takes the sign of the divisor, and is smaller than it
+			const BigInt dividend = MakeNumber(400);
+			for (const BigInt& divisor : { MakeNumber(150), BigInt(7), MakeNumber(12) }) {
+				for (const BigInt& signed_dividend : { dividend, -dividend }) {
+					for (const BigInt& signed_divisor : { divisor, -divisor }) {
+						const auto [quotient, remainder] = BigInt::DivideModulo(signed_dividend, signed_divisor);
+						Assert::IsTrue(quotient * signed_divisor + remainder == signed_dividend);
+						Assert::IsTrue(remainder.IsZero() || remainder.IsNegative() == signed_divisor.IsNegative());
+						Assert::IsTrue((remainder.IsNegative() ? -remainder : remainder) < divisor);
+					}
+				}
+			}
+			Assert::IsTrue(BigInt::DivideModulo(BigInt(-7), BigInt(2)) == std::pair{ BigInt(-4), BigInt(1) });
+			Assert::IsTrue(BigInt::DivideModulo(BigInt(7), BigInt(-2)) == std::pair{ BigInt(-4), BigInt(-1) });
+			Assert::IsTrue(BigInt::DivideModulo(BigInt(3), dividend) == std::pair{ BigInt{}, BigInt(3) });
+		}
+	};
+
 	TEST_CLASS(ParserTypesTest) {
 	public:
 		TEST_METHOD(AtomEqualityValue) {
@@ -435,10 +1529,11 @@ namespace tests
 		TEST_METHOD(AtomEqualityVirtual) {
 			Atom atom_1(Token{ 1, Category::NumericLiteral });
 			Atom atom_2(Token{ 2, Category::NumericLiteral });
-			std::unique_ptr<Statement> ptr_atom_1(std::make_unique<Atom>(atom_1));
-			std::unique_ptr<Statement> ptr_atom_1_duplicate(std::make_unique<Atom>(atom_1));
-			std::unique_ptr<Statement> ptr_atom_2(std::make_unique<Atom>(atom_2));
-			std::unique_ptr<Statement> ptr_grouping_of_atom_1(std::make_unique<Grouping>(std::make_unique<Atom>(atom_1)));
+			Arena arena{};
+			Statement* ptr_atom_1 = arena.Make<Atom>(atom_1);
+			Statement* ptr_atom_1_duplicate = arena.Make<Atom>(atom_1);
+			Statement* ptr_atom_2 = arena.Make<Atom>(atom_2);
+			Statement* ptr_grouping_of_atom_1 = arena.Make<Grouping>(arena.Make<Atom>(atom_1));
 
 			Assert::IsTrue(*ptr_atom_1 == *ptr_atom_1);
 			Assert::IsTrue(*ptr_atom_1 == *ptr_atom_1_duplicate);
@@ -446,24 +1541,95 @@ namespace tests
 			Assert::IsFalse(*ptr_atom_1 == *ptr_grouping_of_atom_1);
 		}
 		TEST_METHOD(BinaryTest) {
-			/*Atom atom_1({ 1, Category::NumericLiteral });
+			Arena arena{};
+			Atom atom_1({ 1, Category::NumericLiteral });
 			Atom atom_2({ 2, Category::NumericLiteral });
-			std::unique_ptr<Expression> exp_atom_1(std::move(&atom_1));
-			std::unique_ptr<Expression> exp_atom_2(std::move(&atom_2));
-			BinaryExpression binary_exp(std::move(exp_atom_1), Token{"+", Category::ArithmeticOperator}, std::move(exp_atom_2));*/
-
-			//Assert::IsTrue(binary_exp )
-			// unary
+			BinaryExpression sum(&atom_1, Token{ "+", Category::ArithmeticOperator }, &atom_2);
+			BinaryExpression sum_duplicate(arena.Make<Atom>(atom_1), Token{ "+", Category::ArithmeticOperator }, arena.Make<Atom>(atom_2));
+			BinaryExpression difference(&atom_1, Token{ "-", Category::ArithmeticOperator }, &atom_2);
+			BinaryExpression swapped(&atom_2, Token{ "+", Category::ArithmeticOperator }, &atom_1);
 
-			//atom 
-			//grouping
+			Assert::IsTrue(sum == sum_duplicate);
+			Assert::IsTrue(sum.Hash() == sum_duplicate.Hash());
+			Assert::IsFalse(sum == difference);
+			Assert::IsFalse(sum.Hash() == difference.Hash());
+			Assert::IsFalse(sum == swapped);
+			Assert::IsFalse(sum.Hash() == swapped.Hash());
 		}
 		TEST_METHOD(UnaryTest) {
+			Atom atom_1({ 1, Category::NumericLiteral });
+			UnaryExpression negation(&atom_1, Token{ "-", Category::ArithmeticOperator });
+			UnaryExpression double_negation(&negation, Token{ "-", Category::ArithmeticOperator });
+			UnaryExpression inversion(&atom_1, Token{ "not", Category::LogicalOperator });
 
+			Assert::IsFalse(negation == double_negation);
+			Assert::IsFalse(negation == inversion);
+			Assert::IsFalse(negation.Hash() == inversion.Hash());
+			Assert::IsFalse(negation == atom_1);
 		}
 		
 		TEST_METHOD(GroupingTest) {
+			Atom atom_1({ 1, Category::NumericLiteral });
+			Grouping grouping(&atom_1);
+			Grouping nested_grouping(&grouping);
+
+			Assert::IsFalse(grouping == atom_1);
+			Assert::IsFalse(grouping.Hash() == atom_1.Hash());
+			Assert::IsFalse(grouping == nested_grouping);
+			Assert::IsFalse(grouping.Hash() == nested_grouping.Hash());
+		}
+		TEST_METHOD(VisitorValid) {
+			// visitors return values and keep state between calls
+			class Summer : public Visitor<Summer, int> {
+			public:
+				int atom_count = 0;
 
+				int VisitBinaryExpression(const BinaryExpression& binary_expression) {
+					return Visit(*binary_expression.left) + Visit(*binary_expression.right);
+				}
+				int VisitUnaryExpression(const UnaryExpression& unary_expression) {
+					return -Visit(*unary_expression.expression);
+				}
+				int VisitGrouping(const Grouping& grouping) {
+					return Visit(*grouping.expression);
+				}
+				int VisitAtom(const Atom& atom) {
+					++atom_count;
+					return static_cast<int>(std::get<int64_t>(atom.value.value));
+				}
+				int VisitAssignment(const Assignment& assignment) {
+					return Visit(*assignment.value);
+				}
+			};
+			std::string input{ "1 + -(2 + 3) + 10" };
+			std::vector<Token> tokens = Lexer::GenerateTokens(input);
+			Parser p(tokens);
+			auto tree = p.BuildTree();
+			Summer summer{};
+			Assert::AreEqual(6, summer.Visit(*tree->statements.front()));
+			Assert::AreEqual(4, summer.atom_count);
+
+			std::ostringstream stream{};
+			TreePrinter printer(stream);
+			printer.Visit(*tree->statements.front());
+			Assert::IsTrue(stream.str().starts_with("visited binary expression: visited binary expression: visited atom: 1\n+\n"));
+		}
+		TEST_METHOD(DeepTreeValid) {
+			// comparing and hashing must not recurse (this is far deeper than the native stack allows)
+			Arena arena{};
+			auto MakeDeepTree = [&arena](int leaf) {
+				Expression* tree = arena.Make<Atom>(Token{ leaf, Category::NumericLiteral });
+				for (int i = 0; i < 1000000; ++i) {
+					tree = i % 2 ? static_cast<Expression*>(arena.Make<Grouping>(tree))
+						: arena.Make<BinaryExpression>(arena.Make<Atom>(Token{ i, Category::NumericLiteral }), Token{ "+", Category::ArithmeticOperator }, tree);
+				}
+				return tree;
+			};
+			const Expression* tree = MakeDeepTree(1);
+			Assert::IsTrue(*tree == *MakeDeepTree(1));
+			Assert::IsTrue(tree->Hash() == MakeDeepTree(1)->Hash());
+			Assert::IsFalse(*tree == *MakeDeepTree(2));
+			Assert::IsFalse(tree->Hash() == MakeDeepTree(2)->Hash());
 		}
 	};
 }